@@ -14,31 +14,123 @@
  * limitations under the License.
  */
 
+#include <fcntl.h>
+#include <getopt.h>
+#include <unistd.h>
+
 #include <lpcsnoop/snoop_listen.hpp>
+#include <sdeventplus/clock.hpp>
+#include <sdeventplus/event.hpp>
+#include <sdeventplus/source/signal.hpp>
+#include <sdeventplus/source/time.hpp>
+#include <sdeventplus/utility/sdbus.hpp>
+#include <stdplus/signal.hpp>
 
+#include <array>
+#include <chrono>
 #include <cstdint>
 #include <cstdio>
-#include <filesystem>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
 #include <string>
+#include <string_view>
 
-namespace fs = std::filesystem;
+using MonotonicTime =
+    sdeventplus::source::Time<sdeventplus::ClockId::Monotonic>;
 
-static void DisplayDbusValue(FILE* f, postcode_t postcodes)
+/*
+ * Writes the latest POST code to the display device, at most once per
+ * refresh interval. Codes received within an interval replace each other,
+ * and only the last one is written when it ends.
+ */
+class Display
 {
-    const auto& postcode = std::get<0>(postcodes);
-    // Uses cstdio instead of streams because the device file has
-    // very strict requirements about the data format and streaming
-    // abstractions tend to muck it up.
-    if (f && !postcode.empty())
+  public:
+    Display(const sdeventplus::Event& event, int fd,
+            std::chrono::microseconds interval) :
+        event(event), fd(fd), interval(interval),
+        timer(event, MonotonicTime::TimePoint(), std::chrono::milliseconds(1),
+              [this](MonotonicTime&, MonotonicTime::TimePoint) { flush(); })
+    {
+        timer.set_enabled(sdeventplus::source::Enabled::Off);
+    }
+
+    void update(lpcsnoop::PostCodeView postcodes)
     {
-        int rc =
-            std::fprintf(f, "%d%02x\n", postcode.size() > 1, postcode.back());
-        if (rc < 0)
+        const auto& postcode = postcodes.primary;
+        if (postcode.empty())
+        {
+            return;
+        }
+
+        // Uses a preformatted buffer and a single write() because the device
+        // file has very strict requirements about the data format.
+        pendingSize = std::snprintf(pending.data(), pending.size(), "%d%02x\n",
+                                    postcode.size() > 1, postcode.back());
+        if (scheduled)
+        {
+            return;
+        }
+
+        auto now = sdeventplus::Clock<sdeventplus::ClockId::Monotonic>(event)
+                       .now();
+        if (writtenSize > 0 && now < lastWrite + interval)
+        {
+            timer.set_time(lastWrite + interval);
+            timer.set_enabled(sdeventplus::source::Enabled::OneShot);
+            scheduled = true;
+            return;
+        }
+        flush();
+    }
+
+  private:
+    void flush()
+    {
+        scheduled = false;
+
+        // Nothing to do if the display already shows this value.
+        if (writtenSize == pendingSize &&
+            std::memcmp(shown.data(), pending.data(), pendingSize) == 0)
+        {
+            return;
+        }
+
+        ssize_t rc = write(fd, pending.data(), pendingSize);
+        if (rc != static_cast<ssize_t>(pendingSize))
         {
-            std::fprintf(stderr, "failed to write 7seg value: rc=%d\n", rc);
+            std::fprintf(stderr, "failed to write 7seg value: %s\n",
+                         rc < 0 ? std::strerror(errno) : "short write");
+            return;
         }
-        std::fflush(f);
+
+        shown = pending;
+        writtenSize = pendingSize;
+        lastWrite =
+            sdeventplus::Clock<sdeventplus::ClockId::Monotonic>(event).now();
     }
+
+    const sdeventplus::Event& event;
+    int fd;
+    std::chrono::microseconds interval;
+    MonotonicTime timer;
+    bool scheduled = false;
+
+    std::array<char, 8> pending{};
+    size_t pendingSize = 0;
+    std::array<char, 8> shown{};
+    size_t writtenSize = 0;
+    MonotonicTime::TimePoint lastWrite;
+};
+
+static void usage(const char* name)
+{
+    std::fprintf(stderr,
+                 "usage: %s [-r <rate>] <device_node>\n"
+                 "  -r, --rate <N>  update the display at most N times per "
+                 "second. Default is 20\n",
+                 name);
 }
 
 /*
@@ -47,34 +139,89 @@ static void DisplayDbusValue(FILE* f, postcode_t postcodes)
  * This application simply creates an object that registers for incoming value
  * updates for the POST code dbus object.
  */
-int main(int argc, const char* argv[])
+int main(int argc, char* argv[])
 {
-    if (argc != 2 || !fs::exists(argv[1]))
+    int rate = 20;
+    int opt;
+
+    // clang-format off
+    static const struct option long_options[] = {
+        {"rate", required_argument, NULL, 'r'},
+        {0, 0, 0, 0}
+    };
+    // clang-format on
+
+    while ((opt = getopt_long(argc, argv, "r:", long_options, NULL)) != -1)
     {
-        std::fprintf(stderr, "usage: %s <device_node>\n", argv[0]);
+        switch (opt)
+        {
+            case 'r':
+                try
+                {
+                    rate = std::stoi(optarg);
+                }
+                catch (...)
+                {
+                    rate = 0;
+                }
+
+                if (rate < 1)
+                {
+                    std::fprintf(stderr, "Invalid rate '%s'. Must be >= 1.\n",
+                                 optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if (optind + 1 != argc)
+    {
+        usage(argv[0]);
+        return -1;
+    }
+
+    int fd = open(argv[optind], O_RDWR | O_CLOEXEC);
+    if (fd < 0)
+    {
+        std::fprintf(stderr, "Unable to open %s: %s\n", argv[optind],
+                     std::strerror(errno));
         return -1;
     }
 
-    static bool sig_recv = false;
-    FILE* f = std::fopen(argv[1], "r+");
+    int ret = 0;
+    try
+    {
+        auto event = sdeventplus::Event::get_default();
+        auto bus = sdbusplus::bus::new_default();
 
-    auto ListenBus = sdbusplus::bus::new_default();
-    std::unique_ptr<lpcsnoop::SnoopListen> snoop =
-        std::make_unique<lpcsnoop::SnoopListen>(ListenBus, DisplayDbusValue, f);
+        auto exitCb = [](sdeventplus::source::Signal& source,
+                         const struct signalfd_siginfo*) {
+            source.get_event().exit(0);
+        };
+        stdplus::signal::block(SIGINT);
+        sdeventplus::source::Signal(event, SIGINT, exitCb).set_floating(true);
+        stdplus::signal::block(SIGTERM);
+        sdeventplus::source::Signal(event, SIGTERM, std::move(exitCb))
+            .set_floating(true);
 
-    signal(SIGINT, [](int signum) {
-        if (signum == SIGINT)
-        {
-            sig_recv = true;
-        }
-    });
+        Display display(event, fd, std::chrono::microseconds(1000000 / rate));
+        lpcsnoop::SnoopListen snoop(
+            bus, [&display](lpcsnoop::PostCodeView postcodes) {
+                display.update(postcodes);
+            });
 
-    while (!sig_recv)
+        ret = sdeventplus::utility::loopWithBus(event, bus);
+    }
+    catch (const std::exception& e)
     {
-        ListenBus.process_discard();
-        ListenBus.wait();
+        std::fprintf(stderr, "%s\n", e.what());
+        ret = -1;
     }
 
-    std::fclose(f);
-    return 0;
+    close(fd);
+    return ret;
 }
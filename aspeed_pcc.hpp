@@ -0,0 +1,126 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+/*
+ * Stateful decoder for the Aspeed PCC snoop device, producing POST codes of
+ * Words bytes.
+ *
+ * Each PCC word contains one byte of port number (MSB) and another byte of
+ * partial postcode (LSB). To get a complete postcode, the PCC words should
+ * follow the sequence 0x40AA, 0x41BB, 0x42CC & 0x43DD, which is decoded as
+ * the postcode 0xDDCCBBAA. A word out of sequence drops the partial code; if
+ * it is a 0x40XX word it starts a new one.
+ *
+ * The decoder holds only fixed-size state, so a code split across reads is
+ * completed by the next call, and every complete code in a buffer is
+ * returned rather than only the first one.
+ */
+template <size_t Words>
+class AspeedPccDecoder
+{
+    static_assert(Words >= 1 && Words <= 4,
+                  "A PCC POST code is made of 1 to 4 words");
+
+  public:
+    static constexpr size_t pccSize = sizeof(uint16_t);
+    /* Bytes the device delivers atomically. */
+    static constexpr size_t unit = pccSize;
+    /* Bytes of each decoded POST code. */
+    static constexpr size_t codeBytes = Words;
+
+    /*
+     * Decode the PCC words in data, calling emit with a span of the code
+     * bytes for each complete POST code. A trailing odd byte is ignored.
+     */
+    template <typename F>
+    void decode(std::span<const uint8_t> data, F&& emit)
+    {
+        constexpr size_t frameBytes = Words * pccSize;
+        const size_t count = data.size() / pccSize;
+        size_t i = 0;
+
+        while (i < count)
+        {
+            // Fast path: when in sync, check the port bytes of a whole code
+            // with one masked compare.
+            if constexpr (std::endian::native == std::endian::little)
+            {
+                if (pending == 0 && count - i >= Words)
+                {
+                    uint64_t frame = 0;
+                    std::memcpy(&frame, &data[i * pccSize], frameBytes);
+                    if ((frame & frameMask) == framePattern)
+                    {
+                        for (size_t w = 0; w < Words; w++)
+                        {
+                            code[Words - 1 - w] = frame >> (16 * w);
+                        }
+                        emit(std::span<const uint8_t>(code));
+                        i += Words;
+                        continue;
+                    }
+                }
+            }
+
+            uint16_t word;
+            std::memcpy(&word, &data[i * pccSize], sizeof(word));
+            i++;
+
+            const uint8_t port = word >> 8;
+            if (port != firstPort + pending)
+            {
+                // Out of sequence, resync on a 0x40XX word.
+                pending = 0;
+                resyncCount++;
+                if (port != firstPort)
+                {
+                    continue;
+                }
+            }
+
+            code[Words - 1 - pending] = word & 0xff;
+            if (++pending == Words)
+            {
+                pending = 0;
+                emit(std::span<const uint8_t>(code));
+            }
+        }
+    }
+
+    /* Out of sequence words seen, each dropping data. */
+    uint64_t resyncs() const
+    {
+        return resyncCount;
+    }
+
+  private:
+    static constexpr uint8_t firstPort = 0x40;
+
+    /* Port bytes of an in-sequence frame as loaded into a uint64_t. */
+    static constexpr uint64_t framePattern = [] {
+        uint64_t pattern = 0;
+        for (size_t w = 0; w < Words; w++)
+        {
+            pattern |= uint64_t(firstPort + w) << (16 * w + 8);
+        }
+        return pattern;
+    }();
+    static constexpr uint64_t frameMask = [] {
+        uint64_t mask = 0;
+        for (size_t w = 0; w < Words; w++)
+        {
+            mask |= uint64_t(0xff) << (16 * w + 8);
+        }
+        return mask;
+    }();
+
+    size_t pending = 0;
+    uint64_t resyncCount = 0;
+    std::array<uint8_t, Words> code{};
+};
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <systemd/sd-bus.h>
+
+#include <sdbusplus/exception.hpp>
+#include <sdbusplus/message.hpp>
+
+/*
+ * sd-bus getter of a read-only property, whose value Get computes on demand
+ * from the object of type T the interface was registered with. Such
+ * properties never signal changes, so keeping them costs nothing on the bus.
+ */
+template <typename T, auto Get>
+int readOnlyProperty(sd_bus*, const char*, const char*, const char*,
+                     sd_bus_message* reply, void* context, sd_bus_error* error)
+{
+    try
+    {
+        sdbusplus::message_t m(reply);
+        m.append(Get(*static_cast<const T*>(context)));
+    }
+    catch (const sdbusplus::exception_t& e)
+    {
+        return sd_bus_error_set(error, e.name(), e.description());
+    }
+
+    return 1;
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "aspeed_pcc.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <variant>
+
+/* Raw snoop data, where every Size bytes read form one POST code. */
+template <size_t Size>
+class RawDecoder
+{
+    static_assert(Size >= 1 && Size <= 8, "A POST code is 1 to 8 bytes");
+
+  public:
+    /* Bytes the device delivers atomically. */
+    static constexpr size_t unit = Size;
+    /* Bytes of each decoded POST code. */
+    static constexpr size_t codeBytes = Size;
+
+    template <typename F>
+    void decode(std::span<const uint8_t> data, F&& emit)
+    {
+        for (size_t offset = 0; offset + Size <= data.size(); offset += Size)
+        {
+            emit(data.subspan(offset, Size));
+        }
+    }
+
+    /* Raw data has no framing to lose sync with. */
+    static constexpr uint64_t resyncs()
+    {
+        return 0;
+    }
+};
+
+/*
+ * Every decoder specialization snoopd can run. The decoder is picked once at
+ * startup and visited once per buffer read, so the per-code path of each
+ * specialization is inlined with no type-erased call.
+ */
+using Decoder =
+    std::variant<RawDecoder<1>, RawDecoder<2>, RawDecoder<3>, RawDecoder<4>,
+                 RawDecoder<5>, RawDecoder<6>, RawDecoder<7>, RawDecoder<8>,
+                 AspeedPccDecoder<1>, AspeedPccDecoder<2>,
+                 AspeedPccDecoder<3>, AspeedPccDecoder<4>>;
+
+/* Bytes the decoder consumes atomically from the device. */
+inline size_t decoderUnit(const Decoder& decoder)
+{
+    return std::visit([](const auto& d) { return d.unit; }, decoder);
+}
+
+/* Instantiate D<n> for a size n known only at runtime, if n is in Sizes. */
+template <template <size_t> typename D, size_t... Sizes>
+std::optional<Decoder> makeSizedDecoder(size_t n,
+                                        std::index_sequence<Sizes...>)
+{
+    std::optional<Decoder> decoder;
+    ((n == Sizes + 1 ? (decoder.emplace(D<Sizes + 1>{}), true) : false) ||
+     ...);
+    return decoder;
+}
+
+/* A named snoop source type, mapping a code size to its decoder. */
+struct DecoderType
+{
+    std::string_view name;
+    std::optional<Decoder> (*make)(size_t codeSize);
+};
+
+/*
+ * Registry of the supported snoop sources. To support another snoop device
+ * (e.g. Nuvoton BPC), add its decoder template to Decoder and an entry here.
+ */
+inline constexpr std::array<DecoderType, 2> decoderTypes = {{
+    {"raw",
+     [](size_t codeSize) {
+         return makeSizedDecoder<RawDecoder>(codeSize,
+                                             std::make_index_sequence<8>());
+     }},
+    {"aspeed-pcc",
+     [](size_t codeSize) -> std::optional<Decoder> {
+         // Two bytes are read for each PCC word of a full code, reads of
+         // half a word could never be decoded.
+         if (codeSize % 2 != 0)
+         {
+             return std::nullopt;
+         }
+         return makeSizedDecoder<AspeedPccDecoder>(
+             codeSize / 2, std::make_index_sequence<4>());
+     }},
+}};
+
+/* Look up a decoder by registry name, std::nullopt if unknown or invalid. */
+inline std::optional<Decoder> makeDecoder(std::string_view name,
+                                          size_t codeSize)
+{
+    for (const auto& type : decoderTypes)
+    {
+        if (type.name == name)
+        {
+            return type.make(codeSize);
+        }
+    }
+    return std::nullopt;
+}
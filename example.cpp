@@ -15,24 +15,159 @@
  */
 
 #include "lpcsnoop/snoop_listen.hpp"
+#include "lpcsnoop/stream.hpp"
 
+#include <getopt.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <sdbusplus/bus/match.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
 #include <cinttypes>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
 
-/* Example PostCode handler which simply prints them */
-static void printPostcode(FILE*, postcode_t postcode)
+/*
+ * Example PostCode handler which simply prints them. The code is a view into
+ * the signal, copy it to keep it past the call.
+ */
+static void printPostcode(lpcsnoop::PostCodeView postcode)
 {
     /* Print output to verify the example program is receiving values. */
-    auto code = std::get<0>(postcode);
-    std::string hexCode;
-    hexCode.reserve(2 * code.size());
-    for (const auto& byte : code)
+    std::printf("recv: 0x");
+    for (const auto& byte : postcode.primary)
+    {
+        std::printf("%02x", byte);
+    }
+    std::printf("\n");
+}
+
+/*
+ * Print the POST codes streamed by snoopd --stream on the socket at path,
+ * without going through D-Bus. Returns when snoopd closes the stream.
+ */
+static int printStream(const char* path)
+{
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd < 0 ||
+        connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0)
+    {
+        std::fprintf(stderr, "Unable to connect to %s: %s\n", path,
+                     std::strerror(errno));
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        return EXIT_FAILURE;
+    }
+
+    std::array<lpcsnoop::StreamRecord, 64> records;
+    ssize_t readb;
+    while ((readb = recv(fd, records.data(), sizeof(records), 0)) > 0)
+    {
+        for (size_t i = 0; i < readb / sizeof(lpcsnoop::StreamRecord); i++)
+        {
+            const auto& r = records[i];
+            if (r.lost > 0)
+            {
+                std::printf("gap: %" PRIu32 " codes lost\n", r.lost);
+                continue;
+            }
+
+            std::printf("recv: 0x");
+            for (size_t b = 0; b < r.size; b++)
+            {
+                std::printf("%02x", r.code[b]);
+            }
+            std::printf("\n");
+        }
+    }
+
+    close(fd);
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Collects the capture-to-receive latency of the POST codes published with
+ * snoopd --timestamps, and prints its percentiles every interval codes.
+ */
+class LatencyReport
+{
+  public:
+    explicit LatencyReport(size_t interval) : interval(interval)
+    {
+        latencies.reserve(interval);
+    }
+
+    void captured(sdbusplus::message_t& m)
     {
-        hexCode += std::format("{:02x}", byte);
+        std::vector<std::tuple<uint64_t, std::vector<uint8_t>>> records;
+        m.read(records);
+
+        // snoopd stamps the codes with CLOCK_MONOTONIC too.
+        const uint64_t now =
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now().time_since_epoch())
+                .count();
+
+        for (const auto& [timestamp, code] : records)
+        {
+            latencies.push_back(now > timestamp ? now - timestamp : 0);
+            if (latencies.size() == interval)
+            {
+                print();
+                latencies.clear();
+            }
+        }
     }
-    std::printf("recv: 0x%s\n", hexCode.c_str());
+
+  private:
+    void print()
+    {
+        std::sort(latencies.begin(), latencies.end());
+        auto percentile = [this](size_t p) {
+            return latencies[(latencies.size() - 1) * p / 100];
+        };
+
+        std::printf("latency us over %zu codes: p50 %" PRIu64 " p90 %" PRIu64
+                    " p99 %" PRIu64 " max %" PRIu64 "\n",
+                    latencies.size(), percentile(50), percentile(90),
+                    percentile(99), latencies.back());
+        std::fflush(stdout);
+    }
+
+    size_t interval;
+    std::vector<uint64_t> latencies;
+};
+
+static void usage(const char* name)
+{
+    std::fprintf(stderr,
+                 "Usage: %s [-l <N>] [-s <PATH>]\n"
+                 "  -l, --latency <N>  instead of printing the POST codes, "
+                 "print the percentiles\n"
+                 "                     of their capture-to-receive latency "
+                 "every N codes.\n"
+                 "                     Needs snoopd --timestamps\n"
+                 "  -s, --stream <PATH> read the POST codes from the snoopd "
+                 "--stream socket\n"
+                 "                     at PATH instead of D-Bus\n",
+                 name);
 }
 
 /*
@@ -64,10 +199,76 @@ static void printPostcode(FILE*, postcode_t postcode)
  * This application simply creates an object that registers for incoming value
  * updates for the POST code dbus object.
  */
-int main()
+int main(int argc, char* argv[])
 {
+    size_t latencyInterval = 0;
+    const char* streamPath = nullptr;
+    int opt;
+
+    // clang-format off
+    static const struct option long_options[] = {
+        {"latency", required_argument, NULL, 'l'},
+        {"stream", required_argument, NULL, 's'},
+        {0, 0, 0, 0}
+    };
+    // clang-format on
+
+    while ((opt = getopt_long(argc, argv, "l:s:", long_options, NULL)) != -1)
+    {
+        switch (opt)
+        {
+            case 'l':
+            {
+                int argVal = -1;
+                try
+                {
+                    argVal = std::stoi(optarg);
+                }
+                catch (...)
+                {}
+
+                if (argVal < 1)
+                {
+                    std::fprintf(stderr,
+                                 "Invalid latency interval '%s'. Must be an "
+                                 "integer greater than 0.\n",
+                                 optarg);
+                    return EXIT_FAILURE;
+                }
+                latencyInterval = argVal;
+                break;
+            }
+            case 's':
+                streamPath = optarg;
+                break;
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if (streamPath)
+    {
+        return printStream(streamPath);
+    }
+
     auto ListenBus = sdbusplus::bus::new_default();
-    lpcsnoop::SnoopListen snoop(ListenBus, printPostcode);
+    std::unique_ptr<lpcsnoop::SnoopListen> snoop;
+    std::unique_ptr<LatencyReport> report;
+    std::unique_ptr<sdbusplus::bus::match_t> captured;
+
+    if (latencyInterval > 0)
+    {
+        report = std::make_unique<LatencyReport>(latencyInterval);
+        captured = std::make_unique<sdbusplus::bus::match_t>(
+            ListenBus, lpcsnoop::GetCapturedMatchRule(),
+            [&report](sdbusplus::message_t& m) { report->captured(m); });
+    }
+    else
+    {
+        snoop = std::make_unique<lpcsnoop::SnoopListen>(ListenBus,
+                                                        printPostcode);
+    }
 
     while (true)
     {
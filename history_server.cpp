@@ -0,0 +1,98 @@
+#include "history_server.hpp"
+
+#include "lpcsnoop/snoop.hpp"
+
+#include <sdbusplus/exception.hpp>
+#include <sdbusplus/message.hpp>
+
+#include <tuple>
+#include <vector>
+
+const sdbusplus::vtable::vtable_t HistoryServer::vtable[] = {
+    sdbusplus::vtable::start(),
+    sdbusplus::vtable::method(snoopHistoryMethod, "tu", "ta(tay)",
+                              HistoryServer::getHistory),
+    sdbusplus::vtable::method(snoopHistoryRunsMethod, "tu", "ta(tttay)",
+                              HistoryServer::getRuns),
+    sdbusplus::vtable::end()};
+
+HistoryServer::HistoryServer(sdbusplus::bus_t& bus, const char* objPath,
+                             size_t capacity, bool runLength) :
+    codes(capacity, runLength),
+    intf(bus, objPath, snoopHistoryIface, vtable, this)
+{}
+
+int HistoryServer::getHistory(sd_bus_message* msg, void* context,
+                              sd_bus_error* error)
+{
+    auto* self = static_cast<HistoryServer*>(context);
+
+    try
+    {
+        sdbusplus::message_t m(msg);
+        uint64_t from;
+        uint32_t max;
+        m.read(from, max);
+
+        std::vector<PostCodeRecord> records;
+        uint64_t first = self->codes.range(from, max, records);
+
+        std::vector<std::tuple<uint64_t, std::vector<uint8_t>>> reply;
+        reply.reserve(records.size());
+        for (const auto& r : records)
+        {
+            auto bytes = r.bytes();
+            reply.emplace_back(r.timestamp, std::vector<uint8_t>(
+                                                bytes.begin(), bytes.end()));
+        }
+
+        auto ret = m.new_method_return();
+        ret.append(first, reply);
+        ret.method_return();
+    }
+    catch (const sdbusplus::exception_t& e)
+    {
+        return sd_bus_error_set(error, e.name(), e.description());
+    }
+
+    return 1;
+}
+
+int HistoryServer::getRuns(sd_bus_message* msg, void* context,
+                           sd_bus_error* error)
+{
+    auto* self = static_cast<HistoryServer*>(context);
+
+    try
+    {
+        sdbusplus::message_t m(msg);
+        uint64_t from;
+        uint32_t max;
+        m.read(from, max);
+
+        std::vector<PostCodeRecord> records;
+        uint64_t first = self->codes.range(from, max, records);
+
+        std::vector<
+            std::tuple<uint64_t, uint64_t, uint64_t, std::vector<uint8_t>>>
+            reply;
+        reply.reserve(records.size());
+        for (const auto& r : records)
+        {
+            auto bytes = r.bytes();
+            reply.emplace_back(r.timestamp, r.lastTimestamp, r.repeats,
+                               std::vector<uint8_t>(bytes.begin(),
+                                                    bytes.end()));
+        }
+
+        auto ret = m.new_method_return();
+        ret.append(first, reply);
+        ret.method_return();
+    }
+    catch (const sdbusplus::exception_t& e)
+    {
+        return sd_bus_error_set(error, e.name(), e.description());
+    }
+
+    return 1;
+}
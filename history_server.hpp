@@ -0,0 +1,44 @@
+#pragma once
+
+#include "post_code_history.hpp"
+
+#include <sdbusplus/bus.hpp>
+#include <sdbusplus/server.hpp>
+#include <sdbusplus/vtable.hpp>
+
+#include <cstdint>
+#include <span>
+
+/*
+ * Keeps the POST code history of one snoop object and serves it on D-Bus
+ * through the GetHistory method of the history interface, so a reader can
+ * fetch everything it missed in one call.
+ */
+class HistoryServer
+{
+  public:
+    HistoryServer(sdbusplus::bus_t& bus, const char* objPath,
+                  size_t capacity, bool runLength = false);
+
+    /* Record a code captured at timestamp (CLOCK_MONOTONIC, usec). */
+    void record(uint64_t timestamp, std::span<const uint8_t> code)
+    {
+        codes.record(timestamp, code);
+    }
+
+    const PostCodeHistory& history() const
+    {
+        return codes;
+    }
+
+  private:
+    static int getHistory(sd_bus_message* msg, void* context,
+                          sd_bus_error* error);
+    static int getRuns(sd_bus_message* msg, void* context,
+                       sd_bus_error* error);
+
+    static const sdbusplus::vtable::vtable_t vtable[];
+
+    PostCodeHistory codes;
+    sdbusplus::server::interface_t intf;
+};
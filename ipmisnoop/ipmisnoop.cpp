@@ -1,10 +1,35 @@
 #include "ipmisnoop.hpp"
 
+#include <sdbusplus/slot.hpp>
+#include <sdeventplus/clock.hpp>
+#include <sdeventplus/source/time.hpp>
+#include <sdeventplus/utility/sdbus.hpp>
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+
+std::vector<std::unique_ptr<sdbusplus::server::manager_t>> managers;
 std::vector<std::unique_ptr<IpmiPostReporter>> reporters;
+
+/* Object path of each host's POST code object to its host number. */
+static std::unordered_map<std::string, size_t, SnoopPathHash, std::equal_to<>>
+    hostByPath;
+/* One match for the POST code changes of every host. */
+static std::optional<sdbusplus::bus::match_t> rawPropertiesChanged;
 bool sevenSegmentLedEnabled = true;
-std::vector<gpiod::line> led_lines;
+gpiod::line_bulk led_lines;
 
-uint32_t getSelectorPosition(sdbusplus::bus_t& bus)
+size_t selectorPosition = 0;
+/* Set once a Position PropertiesChanged has been seen. */
+static bool selectorPositionChanged = false;
+/* Pending Properties.Get call seeding selectorPosition. */
+static std::optional<sdbusplus::slot_t> selectorPositionCall;
+
+void requestSelectorPosition(sdbusplus::bus_t& bus)
 {
     const std::string propertyName = "Position";
 
@@ -13,18 +38,31 @@ uint32_t getSelectorPosition(sdbusplus::bus_t& bus)
                             "org.freedesktop.DBus.Properties", "Get");
     method.append(selectorIface.c_str(), propertyName);
 
-    try
-    {
-        std::variant<uint32_t> value{};
-        auto reply = bus.call(method);
-        reply.read(value);
-        return std::get<uint32_t>(value);
-    }
-    catch (const sdbusplus::exception_t& ex)
-    {
-        std::cerr << "GetProperty call failed. " << ex.what() << std::endl;
-        return 0;
-    }
+    selectorPositionCall = bus.call_async(
+        method, [](sdbusplus::message_t& reply) {
+            if (reply.is_method_error())
+            {
+                std::cerr << "GetProperty call failed." << std::endl;
+                return;
+            }
+
+            try
+            {
+                Selector::PropertiesVariant value{};
+                reply.read(value);
+
+                // A PropertiesChanged received meanwhile is more recent.
+                if (!selectorPositionChanged)
+                {
+                    selectorPosition = std::get<size_t>(value);
+                }
+            }
+            catch (const std::exception& ex)
+            {
+                std::cerr << "GetProperty call failed. " << ex.what()
+                          << std::endl;
+            }
+        });
 }
 
 // Configure the seven segment display connected GPIOs direction
@@ -33,7 +71,7 @@ static int configGPIODirOutput()
     std::string gpioStr;
     // Need to define gpio names LED_POST_CODE_0 to 8 in dts file
     std::string gpioName = "LED_POST_CODE_";
-    const int value = 0;
+    const std::vector<int> values(8, 0);
 
     for (int iteration = 0; iteration < 8; iteration++)
     {
@@ -52,51 +90,182 @@ static int configGPIODirOutput()
             return -1;
         }
 
-        led_lines.push_back(gpioLine);
-        // Request GPIO output to specified value
-        try
-        {
-            gpioLine.request({__FUNCTION__,
-                              gpiod::line_request::DIRECTION_OUTPUT,
-                              gpiod::line_request::FLAG_ACTIVE_LOW},
-                             value);
-        }
-        catch (std::exception&)
-        {
-            std::string errMsg = "Failed to request " + gpioStr + " output";
-            std::cerr << errMsg.c_str() << std::endl;
-            return -1;
-        }
+        led_lines.append(gpioLine);
+    }
+
+    // Request all GPIOs as outputs to specified values at once
+    try
+    {
+        led_lines.request({__FUNCTION__, gpiod::line_request::DIRECTION_OUTPUT,
+                           gpiod::line_request::FLAG_ACTIVE_LOW},
+                          values);
+    }
+    catch (std::exception&)
+    {
+        std::cerr << "Failed to request " << gpioName << "* outputs"
+                  << std::endl;
+        return -1;
     }
 
     return 0;
 }
 
 // Display the received postcode into seven segment display
-int IpmiPostReporter::postCodeDisplay(uint8_t status)
+static int postCodeDisplay(uint8_t status)
 {
+    static std::vector<int> values(8);
+
     for (int iteration = 0; iteration < 8; iteration++)
     {
         // split byte to write into GPIOs
-        int value = !((status >> iteration) & 0x01);
+        values[iteration] = !((status >> iteration) & 0x01);
+    }
 
-        led_lines[iteration].set_value(value);
+    // One ioctl updates every segment together.
+    try
+    {
+        led_lines.set_values(values);
+    }
+    catch (std::exception&)
+    {
+        return -1;
     }
     return 0;
 }
 
-void IpmiPostReporter::getSelectorPositionSignal(sdbusplus::bus_t& bus)
+using MonotonicTime =
+    sdeventplus::source::Time<sdeventplus::ClockId::Monotonic>;
+
+/* Minimum time between two display updates, zero for no cap. */
+static std::chrono::microseconds displayInterval{0};
+/* Code waiting for the next display frame, latest wins. */
+static std::optional<uint8_t> pendingCode;
+static std::optional<uint8_t> displayedCode;
+static MonotonicTime::TimePoint lastDisplay;
+/* Fires at the next display frame while a code is pending. */
+static std::optional<MonotonicTime> displayTimer;
+
+static MonotonicTime::TimePoint monotonicNow()
 {
-    constexpr uint8_t minPositionVal = 0;
-    constexpr uint8_t maxPositionVal = 5;
+    return MonotonicTime::TimePoint(
+        std::chrono::duration_cast<MonotonicTime::TimePoint::duration>(
+            std::chrono::steady_clock::now().time_since_epoch()));
+}
 
-    size_t posVal = 0;
+// Write the pending postcode unless the display already shows it
+static void flushDisplay(MonotonicTime::TimePoint now)
+{
+    uint8_t code = *pendingCode;
+    pendingCode.reset();
 
-    static auto matchSignal = std::make_unique<sdbusplus::bus::match_t>(
+    if (displayedCode == code)
+    {
+        return;
+    }
+    if (postCodeDisplay(code) < 0)
+    {
+        fprintf(stderr, "Error in display the postcode\n");
+        return;
+    }
+    displayedCode = code;
+    lastDisplay = now;
+}
+
+// Show a postcode on the seven segment display, at most once per frame
+static void displayPostCode(uint8_t code)
+{
+    // A frame is already scheduled, it will show this code instead.
+    if (pendingCode)
+    {
+        pendingCode = code;
+        return;
+    }
+    pendingCode = code;
+
+    auto now = monotonicNow();
+    if (displayTimer && now < lastDisplay + displayInterval)
+    {
+        displayTimer->set_time(lastDisplay + displayInterval);
+        displayTimer->set_enabled(sdeventplus::source::Enabled::OneShot);
+        return;
+    }
+    flushDisplay(now);
+}
+
+// Display the POST code of the selected host when any host's code changes
+static void postCodeChanged(sdbusplus::message_t& msg)
+{
+    using primarycode_t = std::vector<uint8_t>;
+    using secondarycode_t = std::vector<uint8_t>;
+    using postcode_t = std::tuple<primarycode_t, secondarycode_t>;
+
+    /* sevenSegmentLedEnabled flag is set when GPIO pins are not there 7 seg
+    display for fewer platforms. So, the code for postcode display and Get
+    Selector position can be skipped in those platforms.
+    */
+    if (!sevenSegmentLedEnabled)
+    {
+        return;
+    }
+
+    auto host = hostByPath.find(std::string_view(msg.get_path()));
+    if (host == hostByPath.end())
+    {
+        return;
+    }
+    size_t hostNum = host->second;
+
+    std::string InterfaceName;
+    std::map<std::string, std::variant<postcode_t>> msgData;
+    msg.read(InterfaceName, msgData);
+
+    size_t position = selectorPosition;
+
+    if (position > maxPosition)
+    {
+        std::cerr << "Invalid position. Position should be 1 to 4 "
+                     "for all hosts "
+                  << std::endl;
+    }
+
+    // Check if it was the Value property that changed.
+    auto valPropMap = msgData.find("Value");
+    if (valPropMap == msgData.end())
+    {
+        std::cerr << "Value property is not found " << std::endl;
+        return;
+    }
+    auto postcode = std::get<0>(std::get<postcode_t>(valPropMap->second));
+
+    if (postcode.size() == 1)
+    {
+        if (position == hostNum)
+        {
+            // write postcode into seven segment display
+            displayPostCode(postcode[0]);
+        }
+        else
+        {
+            fprintf(stderr, "Host Selector Position and host "
+                            "number is not matched..\n");
+        }
+    }
+    else
+    {
+        fprintf(stderr, "invalid postcode value \n");
+    }
+}
+
+void IpmiPostReporter::getSelectorPositionSignal(sdbusplus::bus_t& bus)
+{
+    selectorPositionSignal.emplace(
         bus,
         sdbusplus::bus::match::rules::propertiesChanged(selectorObject,
                                                         selectorIface),
-        [&](sdbusplus::message_t& msg) {
+        [this](sdbusplus::message_t& msg) {
+            constexpr uint8_t minPositionVal = 0;
+            constexpr uint8_t maxPositionVal = 5;
+
             std::string objectName;
             std::map<std::string, Selector::PropertiesVariant> msgData;
             msg.read(objectName, msgData);
@@ -109,7 +278,9 @@ void IpmiPostReporter::getSelectorPositionSignal(sdbusplus::bus_t& bus)
                     return;
                 }
 
-                posVal = std::get<size_t>(valPropMap->second);
+                size_t posVal = std::get<size_t>(valPropMap->second);
+                selectorPosition = posVal;
+                selectorPositionChanged = true;
 
                 if (posVal > minPositionVal && posVal < maxPositionVal)
                 {
@@ -118,10 +289,7 @@ void IpmiPostReporter::getSelectorPositionSignal(sdbusplus::bus_t& bus)
                     auto postcode = std::get<0>(postcodes);
 
                     // write postcode into seven segment display
-                    if (postCodeDisplay(postcode[0]) < 0)
-                    {
-                        fprintf(stderr, "Error in display the postcode\n");
-                    }
+                    displayPostCode(postcode[0]);
                 }
             }
         });
@@ -130,7 +298,8 @@ void IpmiPostReporter::getSelectorPositionSignal(sdbusplus::bus_t& bus)
 // handle muti-host D-bus
 int postCodeIpmiHandler(const std::string& snoopObject,
                         const std::string& snoopDbus, sdbusplus::bus_t& bus,
-                        std::span<std::string> host)
+                        sdeventplus::Event& event,
+                        std::span<std::string> host, unsigned int displayRate)
 {
     int ret = 0;
 
@@ -140,15 +309,25 @@ int postCodeIpmiHandler(const std::string& snoopObject,
         {
             std::string objPathInst = snoopObject + host[iteration];
 
-            sdbusplus::server::manager_t m{bus, objPathInst.c_str()};
+            managers.emplace_back(
+                std::make_unique<sdbusplus::server::manager_t>(
+                    bus, objPathInst.c_str()));
 
             /* Create a monitor object and let it do all the rest */
             reporters.emplace_back(
                 std::make_unique<IpmiPostReporter>(bus, objPathInst.c_str()));
 
             reporters[iteration]->emit_object_added();
+
+            hostByPath.emplace(objPathInst, std::stoul(host[iteration]));
         }
 
+        rawPropertiesChanged.emplace(
+            bus,
+            sdbusplus::bus::match::rules::propertiesChangedNamespace(rawObject,
+                                                                     rawIface),
+            postCodeChanged);
+
         bus.request_name(snoopDbus.c_str());
 
         /* sevenSegmentLedEnabled flag is unset when GPIO pins are not there 7
@@ -157,7 +336,10 @@ int postCodeIpmiHandler(const std::string& snoopObject,
         */
         if (sevenSegmentLedEnabled)
         {
+            // Seed the cached position only once the match is in place, so
+            // that no update is missed.
             reporters[0]->getSelectorPositionSignal(bus);
+            requestSelectorPosition(bus);
         }
         else
         {
@@ -176,11 +358,27 @@ int postCodeIpmiHandler(const std::string& snoopObject,
         fprintf(stderr, "Failed find the gpio line. Cannot display postcodes "
                         "in seven segment display..\n");
     }
-
-    while (true)
+    else if (displayRate > 0)
     {
-        bus.process_discard();
-        bus.wait();
+        displayInterval = std::chrono::microseconds(1000000 / displayRate);
+        displayTimer.emplace(
+            event, MonotonicTime::TimePoint(), std::chrono::milliseconds(1),
+            [](MonotonicTime&, MonotonicTime::TimePoint) {
+                flushDisplay(monotonicNow());
+            });
+        displayTimer->set_enabled(sdeventplus::source::Enabled::Off);
     }
-    exit(EXIT_SUCCESS);
+
+    // Signal handling and any other event sources are set up by the caller
+    // on the same event loop.
+    ret = sdeventplus::utility::loopWithBus(event, bus);
+
+    // The objects and matches must go before the bus connection does.
+    displayTimer.reset();
+    selectorPositionCall.reset();
+    rawPropertiesChanged.reset();
+    reporters.clear();
+    managers.clear();
+
+    return ret;
 }
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Histogram of latencies in microseconds with power of two buckets. Bucket 0
+ * counts latencies of 0, bucket i latencies in [2^(i-1), 2^i), and the last
+ * bucket everything from 2^(buckets-2) on. Recording is a bit scan and an
+ * increment.
+ */
+class LatencyHistogram
+{
+  public:
+    static constexpr size_t buckets = 20;
+
+    void record(uint64_t usec)
+    {
+        counts[std::min<size_t>(std::bit_width(usec), buckets - 1)]++;
+    }
+
+    const std::array<uint64_t, buckets>& bucketCounts() const
+    {
+        return counts;
+    }
+
+  private:
+    std::array<uint64_t, buckets> counts{};
+};
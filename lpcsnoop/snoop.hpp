@@ -2,12 +2,75 @@
 
 #include <sdbusplus/bus.hpp>
 #include <sdbusplus/server.hpp>
+#include <sdbusplus/vtable.hpp>
 #include <xyz/openbmc_project/State/Boot/Raw/server.hpp>
 
+#include <functional>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+
 /* The LPC snoop on port 80h is mapped to this dbus path. */
 constexpr char snoopObject[] = "/xyz/openbmc_project/state/boot/raw0";
+/* Snoop device N is mapped to this dbus path followed by N. */
+constexpr char snoopObjectBase[] = "/xyz/openbmc_project/state/boot/raw";
+/* Namespace holding the snoop object of every device or host. */
+constexpr char snoopNamespace[] = "/xyz/openbmc_project/state/boot";
 /* The LPC snoop on port 80h is mapped to this dbus service. */
 constexpr char snoopDbus[] = "xyz.openbmc_project.State.Boot.Raw";
+/*
+ * The interfaces below extend the Raw interface of the snoop object. They
+ * have no phosphor-dbus-interfaces definition yet, so they live in this
+ * project's own namespace until they do.
+ */
+/* Interface carrying batched POST codes on the snoop object. */
+constexpr char snoopBatchIface[] = "org.openbmc.lpcsnoop.Batch";
+/* Batch signal: sequence number of the first code, then the codes. */
+constexpr char snoopBatchSignal[] = "PostCodes";
+/* Interface serving the recent POST code history on the snoop object. */
+constexpr char snoopHistoryIface[] = "org.openbmc.lpcsnoop.History";
+/*
+ * GetHistory(t from, u max) -> (t first, a(tay) records): up to max records
+ * of (CLOCK_MONOTONIC microseconds, code) starting at sequence number from,
+ * or at the oldest one still held. first is the sequence of records[0].
+ */
+constexpr char snoopHistoryMethod[] = "GetHistory";
+/*
+ * GetRuns(t from, u max) -> (t first, a(tttay) records): like GetHistory,
+ * with each record as (first time, last time, repeats, code). Repeats are
+ * only merged into one record with snoopd --run-length.
+ */
+constexpr char snoopHistoryRunsMethod[] = "GetRuns";
+/*
+ * Interface signalling runs of a repeated POST code. The Repeated signal
+ * (ay code, t repeats, t first time, t last time) is sent at most once per
+ * run-length interval while a run lasts, and for the last repeats once the
+ * interval is over or the run ends. Value only changes for the first code of
+ * a run, its repeats are only signalled by Repeated.
+ */
+constexpr char snoopRunIface[] = "org.openbmc.lpcsnoop.Run";
+constexpr char snoopRunSignal[] = "Repeated";
+/*
+ * Interface with the POST code rate limit (u Limit, codes per second) and the
+ * number of codes Passed, Coalesced and Dropped by it (t each).
+ */
+constexpr char snoopRateLimitIface[] = "org.openbmc.lpcsnoop.RateLimit";
+/*
+ * Interface with the snoop device counters (t each): Reads, Bytes, Codes
+ * decoded, decoder Resyncs, RateLimitActivations of the rate limit, WouldBlock
+ * and EndOfFile read results, RingDroppedBytes and RingHighWaterMark of the
+ * snoopd --threaded reader ring, and the at Latency histogram from read to
+ * publication, see LatencyHistogram.
+ */
+constexpr char snoopMetricsIface[] = "org.openbmc.lpcsnoop.Metrics";
+/* Interface carrying the capture time of the published POST codes. */
+constexpr char snoopTimestampIface[] = "org.openbmc.lpcsnoop.Timestamp";
+/*
+ * Captured signal: a(tay) records of (CLOCK_MONOTONIC microseconds the code
+ * was read from the snoop device, code), sent after each batch signal.
+ */
+constexpr char snoopCapturedSignal[] = "Captured";
 
 template <typename... T>
 using ServerObject = typename sdbusplus::server::object_t<T...>;
@@ -16,6 +79,18 @@ using PostObject = ServerObject<PostInterface>;
 using primary_post_code_t = std::vector<uint8_t>;
 using secondary_post_code_t = std::vector<uint8_t>;
 using postcode_t = std::tuple<primary_post_code_t, secondary_post_code_t>;
+using captured_post_code_t = std::tuple<uint64_t, primary_post_code_t>;
+
+/* Hash allowing lookups of snoop object paths by std::string_view. */
+struct SnoopPathHash
+{
+    using is_transparent = void;
+
+    size_t operator()(std::string_view path) const
+    {
+        return std::hash<std::string_view>{}(path);
+    }
+};
 
 class PostReporter : public PostObject
 {
@@ -23,7 +98,131 @@ class PostReporter : public PostObject
     PostReporter(sdbusplus::bus_t& bus, const char* objPath, bool defer) :
         PostObject(bus, objPath,
                    defer ? PostObject::action::defer_emit
-                         : PostObject::action::emit_object_added)
+                         : PostObject::action::emit_object_added),
+        bus(bus), objPath(objPath)
     {}
-    unsigned int rateLimit = 0;
+
+    /*
+     * Register the batch interface. From then on codes passed to queue() are
+     * published together by flush() as a single batch signal.
+     */
+    void enableBatch()
+    {
+        batchIntf.emplace(bus, objPath.c_str(), snoopBatchIface, batchVtable,
+                          this);
+    }
+
+    bool batching() const
+    {
+        return batchIntf.has_value();
+    }
+
+    /*
+     * Register the timestamp interface, along with the batch interface. From
+     * then on codes passed to captured() are published with their capture
+     * time by flush().
+     */
+    void enableTimestamps()
+    {
+        if (!batching())
+        {
+            enableBatch();
+        }
+        timestampIntf.emplace(bus, objPath.c_str(), snoopTimestampIface,
+                              timestampVtable, this);
+    }
+
+    bool timestamping() const
+    {
+        return timestampIntf.has_value();
+    }
+
+    /* Register the run interface, for repeated(). */
+    void enableRuns()
+    {
+        runIntf.emplace(bus, objPath.c_str(), snoopRunIface, runVtable, this);
+    }
+
+    /* Signal that code was read repeats times in a row, from first to last. */
+    void repeated(std::span<const uint8_t> code, uint64_t repeats,
+                  uint64_t first, uint64_t last)
+    {
+        auto m = runIntf->new_signal(snoopRunSignal);
+        m.append(primary_post_code_t(code.begin(), code.end()), repeats, first,
+                 last);
+        m.signal_send();
+    }
+
+    /*
+     * Publish the time code was read at as a Captured signal with the next
+     * flush().
+     */
+    void captured(uint64_t timestamp, std::span<const uint8_t> code)
+    {
+        captures.emplace_back(timestamp,
+                              primary_post_code_t(code.begin(), code.end()));
+    }
+
+    void queue(std::span<const uint8_t> code)
+    {
+        batch.emplace_back(primary_post_code_t(code.begin(), code.end()),
+                           secondary_post_code_t{});
+    }
+
+    /*
+     * Emit all queued codes as one batch signal tagged with the sequence
+     * number of the first code, so consumers can detect gaps, and update
+     * Value to the last code.
+     */
+    void flush()
+    {
+        if (batch.empty())
+        {
+            return;
+        }
+
+        auto m = batchIntf->new_signal(snoopBatchSignal);
+        m.append(sequence, batch);
+        m.signal_send();
+        sequence += batch.size();
+
+        if (!captures.empty())
+        {
+            sendCaptures();
+        }
+
+        value(std::move(batch.back()));
+        batch.clear();
+    }
+
+  private:
+    void sendCaptures()
+    {
+        auto m = timestampIntf->new_signal(snoopCapturedSignal);
+        m.append(captures);
+        m.signal_send();
+        captures.clear();
+    }
+
+    static constexpr sdbusplus::vtable::vtable_t batchVtable[] = {
+        sdbusplus::vtable::start(),
+        sdbusplus::vtable::signal(snoopBatchSignal, "ta(ayay)"),
+        sdbusplus::vtable::end()};
+    static constexpr sdbusplus::vtable::vtable_t timestampVtable[] = {
+        sdbusplus::vtable::start(),
+        sdbusplus::vtable::signal(snoopCapturedSignal, "a(tay)"),
+        sdbusplus::vtable::end()};
+    static constexpr sdbusplus::vtable::vtable_t runVtable[] = {
+        sdbusplus::vtable::start(),
+        sdbusplus::vtable::signal(snoopRunSignal, "ayttt"),
+        sdbusplus::vtable::end()};
+
+    sdbusplus::bus_t& bus;
+    std::string objPath;
+    std::optional<sdbusplus::server::interface_t> batchIntf;
+    std::vector<postcode_t> batch;
+    uint64_t sequence = 0;
+    std::optional<sdbusplus::server::interface_t> timestampIntf;
+    std::vector<captured_post_code_t> captures;
+    std::optional<sdbusplus::server::interface_t> runIntf;
 };
@@ -16,27 +16,78 @@
 
 #include "lpcsnoop/snoop.hpp"
 
+#include <systemd/sd-bus.h>
+
 #include <sdbusplus/bus.hpp>
 #include <sdbusplus/bus/match.hpp>
 #include <sdbusplus/message.hpp>
 
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
 namespace lpcsnoop
 {
 using std::get;
 
+/*
+ * Returns matching string for what signal to listen on Dbus, for the objects
+ * selected by objectRule.
+ */
+inline const std::string GetMatchRule(const std::string& objectRule)
+{
+    using namespace sdbusplus::bus::match::rules;
+
+    return type::signal() + sender(snoopDbus) +
+           interface("org.freedesktop.DBus.Properties") +
+           member("PropertiesChanged") + objectRule +
+           argN(0, PostInterface::interface);
+}
+
 /* Returns matching string for what signal to listen on Dbus */
-static const std::string GetMatchRule()
+inline const std::string GetMatchRule()
+{
+    return GetMatchRule(sdbusplus::bus::match::rules::path(snoopObject));
+}
+
+/* Returns matching string for the snoop objects of every host */
+inline const std::string GetHostsMatchRule()
+{
+    return GetMatchRule(
+        sdbusplus::bus::match::rules::path_namespace(snoopNamespace));
+}
+
+/* Returns matching string for the Captured signals of every host */
+inline const std::string GetCapturedMatchRule()
 {
     using namespace sdbusplus::bus::match::rules;
 
-    return type::signal() + interface("org.freedesktop.DBus.Properties") +
-           member("PropertiesChanged") + path(snoopObject);
+    return type::signal() + sender(snoopDbus) +
+           interface(snoopTimestampIface) + member(snoopCapturedSignal) +
+           path_namespace(snoopNamespace);
 }
 
+/*
+ * Primary and secondary POST code of a PropertiesChanged signal. The spans
+ * point into the message and are only valid during the handler call.
+ */
+struct PostCodeView
+{
+    std::span<const uint8_t> primary;
+    std::span<const uint8_t> secondary;
+};
+
 class SnoopListen
 {
     using message_handler_t = std::function<void(sdbusplus::message_t&)>;
     using postcode_handler_t = std::function<void(FILE*, postcode_t)>;
+    using postcode_view_handler_t = std::function<void(PostCodeView)>;
+    using host_postcode_handler_t = std::function<void(size_t, PostCodeView)>;
 
   public:
     SnoopListen(sdbusplus::bus_t& busIn, sd_bus_message_handler_t handler) :
@@ -53,6 +104,54 @@ class SnoopListen
                                      std::placeholders::_1))
     {}
 
+    /*
+     * Fast path: handler gets a view of each POST code, read in place from
+     * the message without any allocation.
+     */
+    SnoopListen(sdbusplus::bus_t& busIn, postcode_view_handler_t handler) :
+        SnoopListen(busIn, [handler = std::move(handler)](
+                               sdbusplus::message_t& m) {
+            readPostCode(m, handler);
+        })
+    {}
+
+    /*
+     * Listen to the snoop objects of every host, .../boot/raw<N>, with a
+     * single match. handler gets the host number N with each POST code.
+     */
+    SnoopListen(sdbusplus::bus_t& busIn, host_postcode_handler_t handler) :
+        signal(busIn, GetHostsMatchRule(),
+               [handler = std::move(handler)](sdbusplus::message_t& m) {
+                   size_t host;
+                   if (parseHost(m.get_path(), host))
+                   {
+                       readPostCode(m, [&](PostCodeView code) {
+                           handler(host, code);
+                       });
+                   }
+               })
+    {}
+
+    /*
+     * Listen to the snoop objects of the given hosts only, with a single
+     * match. The object path of each host is resolved through a table built
+     * here, and signals of other hosts are ignored.
+     */
+    SnoopListen(sdbusplus::bus_t& busIn, std::span<const size_t> hosts,
+                host_postcode_handler_t handler) :
+        signal(busIn, GetHostsMatchRule(),
+               [handler = std::move(handler),
+                table = makeHostTable(hosts)](sdbusplus::message_t& m) {
+                   auto host = table.find(std::string_view(m.get_path()));
+                   if (host != table.end())
+                   {
+                       readPostCode(m, [&](PostCodeView code) {
+                           handler(host->second, code);
+                       });
+                   }
+               })
+    {}
+
     SnoopListen() = delete; // no default constructor
     ~SnoopListen() = default;
     SnoopListen(const SnoopListen&) = delete;
@@ -63,24 +162,106 @@ class SnoopListen
   private:
     sdbusplus::bus::match_t signal;
 
+    using HostTable = std::unordered_map<std::string, size_t, SnoopPathHash,
+                                         std::equal_to<>>;
+
+    static HostTable makeHostTable(std::span<const size_t> hosts)
+    {
+        HostTable table;
+        for (size_t host : hosts)
+        {
+            table.emplace(snoopObjectBase + std::to_string(host), host);
+        }
+        return table;
+    }
+
+    /* Get N from a .../boot/raw<N> path, without allocating. */
+    static bool parseHost(std::string_view path, size_t& host)
+    {
+        constexpr std::string_view base = snoopObjectBase;
+        if (!path.starts_with(base))
+        {
+            return false;
+        }
+        path.remove_prefix(base.size());
+
+        auto [end, ec] =
+            std::from_chars(path.data(), path.data() + path.size(), host);
+        return ec == std::errc() && end == path.data() + path.size();
+    }
+
     /*
-     * Default message handler which listens to published messages on snoop
-     * DBus path, and calls the given postcode_handler on each value received.
+     * Walk a PropertiesChanged message in place, skipping the properties
+     * other than Value, and call handler with a view of the POST code.
+     *
+     * @return Whether the message held a Value property.
      */
-    static void defaultMessageHandler(postcode_handler_t& handler, FILE* f,
-                                      sdbusplus::message_t& m)
+    template <typename F>
+    static bool readPostCode(sdbusplus::message_t& m, F&& handler)
     {
-        std::string messageBusName;
-        std::map<std::string, std::variant<postcode_t>> messageData;
-        constexpr char propertyKey[] = "Value";
+        sd_bus_message* msg = m.get();
+        const char* name;
 
-        m.read(messageBusName, messageData);
+        // The interface name is already filtered by the match rule.
+        if (sd_bus_message_skip(msg, "s") < 0 ||
+            sd_bus_message_enter_container(msg, 'a', "{sv}") < 0)
+        {
+            return false;
+        }
 
-        if (messageBusName == snoopDbus &&
-            messageData.find(propertyKey) != messageData.end())
+        while (sd_bus_message_enter_container(msg, 'e', "sv") > 0)
         {
-            handler(f, get<postcode_t>(messageData[propertyKey]));
+            if (sd_bus_message_read_basic(msg, 's', &name) < 0)
+            {
+                return false;
+            }
+            if (std::strcmp(name, "Value") != 0)
+            {
+                if (sd_bus_message_skip(msg, "v") < 0 ||
+                    sd_bus_message_exit_container(msg) < 0)
+                {
+                    return false;
+                }
+                continue;
+            }
+
+            const void* primary;
+            const void* secondary;
+            size_t primarySize;
+            size_t secondarySize;
+
+            if (sd_bus_message_enter_container(msg, 'v', "(ayay)") < 0 ||
+                sd_bus_message_enter_container(msg, 'r', "ayay") < 0 ||
+                sd_bus_message_read_array(msg, 'y', &primary, &primarySize) <
+                    0 ||
+                sd_bus_message_read_array(msg, 'y', &secondary,
+                                          &secondarySize) < 0)
+            {
+                return false;
+            }
+
+            handler(PostCodeView{
+                {static_cast<const uint8_t*>(primary), primarySize},
+                {static_cast<const uint8_t*>(secondary), secondarySize}});
+            return true;
         }
+        return false;
+    }
+
+    /*
+     * Default message handler which listens to published messages on snoop
+     * DBus path, and calls the given postcode_handler on each value received.
+     */
+    static void defaultMessageHandler(postcode_handler_t& handler, FILE* f,
+                                      sdbusplus::message_t& m)
+    {
+        readPostCode(m, [&handler, f](PostCodeView code) {
+            handler(f, postcode_t(
+                           primary_post_code_t(code.primary.begin(),
+                                               code.primary.end()),
+                           secondary_post_code_t(code.secondary.begin(),
+                                                 code.secondary.end())));
+        });
     }
 };
 
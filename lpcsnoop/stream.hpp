@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+
+namespace lpcsnoop
+{
+
+/*
+ * Record of the snoopd --stream socket. Each SOCK_SEQPACKET packet holds one
+ * or more of them, in host byte order.
+ */
+struct StreamRecord
+{
+    /* Sequence number of the code, or of the first lost one in a gap. */
+    uint64_t sequence;
+    /* CLOCK_MONOTONIC microseconds the code was read at. */
+    uint64_t timestamp;
+    /*
+     * Non-zero for a gap marker: this many codes were dropped because the
+     * client fell behind. A gap marker holds no code.
+     */
+    uint32_t lost;
+    uint8_t size; /* Bytes used in code */
+    uint8_t code[8];
+};
+
+static_assert(sizeof(StreamRecord) == 32, "StreamRecord is part of the ABI");
+
+} // namespace lpcsnoop
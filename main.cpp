@@ -17,34 +17,57 @@
 #ifdef ENABLE_IPMI_SNOOP
 #include "ipmisnoop/ipmisnoop.hpp"
 #endif
+#include "decoder.hpp"
 #include "lpcsnoop/snoop.hpp"
+#include "realtime.hpp"
+#include "snoop_device.hpp"
 
-#include <endian.h>
 #include <fcntl.h>
 #include <getopt.h>
-#include <sys/epoll.h>
 #include <systemd/sd-event.h>
 #include <unistd.h>
 
 #include <sdeventplus/event.hpp>
-#include <sdeventplus/source/event.hpp>
-#include <sdeventplus/source/io.hpp>
 #include <sdeventplus/source/signal.hpp>
-#include <sdeventplus/source/time.hpp>
 #include <sdeventplus/utility/sdbus.hpp>
 #include <stdplus/signal.hpp>
 
-#include <chrono>
+#include <charconv>
 #include <cstdint>
+#include <cstring>
 #include <exception>
-#include <functional>
 #include <iostream>
-#include <optional>
-#include <thread>
+#include <limits>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <vector>
+
+/* Parse an integer option from min to max, exiting on error. */
+static int parseCount(const char* name, const char* arg, int min,
+                      int max = std::numeric_limits<int>::max())
+{
+    const char* end = arg + strlen(arg);
+    int val;
+    auto [ptr, ec] = std::from_chars(arg, end, val);
 
-static size_t codeSize = 1; /* Size of each POST code in bytes */
-static bool verbose = false;
-static std::function<bool(std::vector<uint8_t>&, ssize_t)> procPostCode;
+    if (ec != std::errc() || ptr != end || val < min || val > max)
+    {
+        if (max == std::numeric_limits<int>::max())
+        {
+            fprintf(stderr, "Invalid %s '%s'. Must be >= %d.\n", name, arg,
+                    min);
+        }
+        else
+        {
+            fprintf(stderr,
+                    "Invalid %s '%s'. Must be an integer from %d to %d.\n",
+                    name, arg, min, max);
+        }
+        exit(EXIT_FAILURE);
+    }
+    return val;
+}
 
 static void usage(const char* name)
 {
@@ -52,218 +75,83 @@ static void usage(const char* name)
             "Usage: %s\n"
 #ifdef ENABLE_IPMI_SNOOP
             "  -h, --host <host instances>  Default is '0'\n"
+            "  -R, --display-rate <N>  Refresh the 7-segment display at most "
+            "N times per second.\n"
+            "                         Default is 0, no limit\n"
 #else
-            "  -d, --device <DEVICE>  use <DEVICE> file.\n"
-            "  -r, --rate-limit=<N>   Only process N POST codes from the "
+            "  -d, --device <DEVICE>  use <DEVICE> file. May be repeated, "
+            "device N is published\n"
+            "                         on .../boot/raw<N>\n"
+            "  -r, --rate-limit=<N>   Only publish N POST codes from the "
             "device per second.\n"
+            "  -m, --rate-limit-mode=<MODE>  'coalesce' (default) keeps the "
+            "latest code over\n"
+            "                         the limit, 'drop' discards them\n"
             "  -b, --bytes <SIZE>     set POST code length to <SIZE> bytes. "
             "Default is 1\n"
+            "  -D, --decoder <NAME>   decode the device data as 'raw' or "
+            "'aspeed-pcc'.\n"
+            "                         Default is picked from the device "
+            "path\n"
+            "  -B, --bulk-read        drain the device into a page-sized "
+            "buffer on each wakeup.\n"
+            "  -P, --batch-publish    publish the POST codes of each event "
+            "loop iteration as one batch signal.\n"
+            "  -t, --threaded         drain the device from a dedicated "
+            "reader thread.\n"
+            "  -T, --timestamps       publish the capture time of each POST "
+            "code with its\n"
+            "                         batch. Implies --batch-publish\n"
+            "  -p, --rt-priority <N>  run the --threaded reader threads under "
+            "SCHED_FIFO at\n"
+            "                         priority N. Default is 0, off\n"
+            "  -c, --cpu <N>          pin the --threaded reader threads to CPU "
+            "N\n"
+            "  -M, --mlock            lock the memory of snoopd to avoid page "
+            "faults.\n"
+            "  -w, --read-budget <N>  read at most N times per wakeup before "
+            "letting other\n"
+            "                         events run. Default is 0, no bound\n"
+            "  -i, --poll-interval <MS>  under load, drain the devices every "
+            "MS milliseconds\n"
+            "                         instead of on each wakeup. Default is "
+            "0, off\n"
+            "  -I, --poll-threshold <N>  wakeups per second that count as "
+            "load. Default is 1000\n"
+            "  -u, --run-length <MS>  merge repeats of a POST code into one "
+            "run, published\n"
+            "                         at most every MS milliseconds. Default "
+            "is 0, off\n"
+            "  -H, --history <N>      keep the last N POST codes for "
+            "GetHistory. Default is 0\n"
+            "  -l, --log <FILE>       persist POST codes to a memory-mapped "
+            "ring log in <FILE>,\n"
+            "                         or <FILE>.<N> for each of several "
+            "devices.\n"
+            "  -L, --log-size <N>     hold up to N POST codes in the log. "
+            "Default is 4096\n"
+            "  -s, --stream <PATH>    stream the POST codes to the clients "
+            "of a SOCK_SEQPACKET\n"
+            "                         socket at <PATH>, or <PATH>.<N> for "
+            "each of several devices.\n"
 #endif
             "  -v, --verbose  Prints verbose information while running\n\n",
             name);
 }
 
-/**
- * Call once for each POST code received. If the number of POST codes exceeds
- * the configured rate limit, this function will disable the snoop device IO
- * source until the end of the 1 second interval, then re-enable it.
- *
- * @return Whether the rate limit is exceeded.
- */
-bool rateLimit(PostReporter& reporter, sdeventplus::source::IO& ioSource)
-{
-    if (reporter.rateLimit == 0)
-    {
-        // Rate limiting is disabled.
-        return false;
-    }
-
-    using Clock = sdeventplus::Clock<sdeventplus::ClockId::Monotonic>;
-
-    static constexpr std::chrono::seconds rateLimitInterval(1);
-    static unsigned int rateLimitCount = 0;
-    static Clock::time_point rateLimitEndTime;
-
-    const sdeventplus::Event& event = ioSource.get_event();
-
-    if (rateLimitCount == 0)
-    {
-        // Initialize the end time when we start a new interval
-        rateLimitEndTime = Clock(event).now() + rateLimitInterval;
-    }
-
-    if (++rateLimitCount < reporter.rateLimit)
-    {
-        return false;
-    }
-
-    rateLimitCount = 0;
-
-    if (rateLimitEndTime < Clock(event).now())
-    {
-        return false;
-    }
-
-    if (verbose)
-    {
-        fprintf(stderr, "Hit POST code rate limit - disabling temporarily\n");
-    }
-
-    ioSource.set_enabled(sdeventplus::source::Enabled::Off);
-    sdeventplus::source::Time<sdeventplus::ClockId::Monotonic>(
-        event, rateLimitEndTime, std::chrono::milliseconds(100),
-        [&ioSource](auto&, auto) {
-            if (verbose)
-            {
-                fprintf(stderr, "Reenabling POST code handler\n");
-            }
-            ioSource.set_enabled(sdeventplus::source::Enabled::On);
-        })
-        .set_floating(true);
-    return true;
-}
-
-/*
- * Split input code into multiple 2 bytes PCC code, If the PCC code prefix
- * matches the check code, store each PCC code in aspeedPCCBuffer, or clear
- * aspeedPCCBuffer if the prefix does not match.
- *
- * Each PCC code contains one byte of port number (MSB) and another byte of
- * partial postcode (LSB). To get a complete postcode, the PCC code should
- * followed the sequence of 0x40AA, 0x41BB, 0x42CC & 0x43DD. When
- * aspeedPCCBuffer contains enough PCC codes, the postcode will be assigned as
- * 0xDDCCBBAA.
- */
-bool aspeedPCC(std::vector<uint8_t>& code, ssize_t readb)
-{
-    // Size of data coming from the PCC hardware
-    constexpr size_t pccSize = sizeof(uint16_t);
-    // Required PCC count of a full postcode, if codeSize is 8 bytes, it means
-    // it require 4 PCC codes in correct sequence to get a complete postcode.
-    const size_t fullPostPCCCount = codeSize / pccSize;
-    // A PCC buffer for storing PCC code in sequence.
-    static std::vector<uint16_t> aspeedPCCBuffer;
-    constexpr uint16_t firstPCCPortNumber = 0x4000;
-    constexpr uint16_t pccPortNumberMask = 0xFF00;
-    constexpr uint16_t pccPostCodeMask = 0x00FF;
-    constexpr uint8_t byteShift = 8;
-
-    uint16_t* codePtr = reinterpret_cast<uint16_t*>(code.data());
-
-    for (size_t i = 0; i < (readb / pccSize); i++)
-    {
-        uint16_t checkCode =
-            firstPCCPortNumber +
-            ((aspeedPCCBuffer.size() % fullPostPCCCount) << byteShift);
-
-        if (checkCode == (codePtr[i] & pccPortNumberMask))
-        {
-            aspeedPCCBuffer.emplace_back(codePtr[i]);
-        }
-        else
-        {
-            aspeedPCCBuffer.clear();
-
-            // keep the PCC code if codePtr[i] matches with 0x40XX as first PCC
-            // code in buffer.
-            if ((codePtr[i] & pccPortNumberMask) == firstPCCPortNumber)
-            {
-                aspeedPCCBuffer.emplace_back(codePtr[i]);
-            }
-        }
-    }
-
-    if (aspeedPCCBuffer.size() < fullPostPCCCount)
-    {
-        // not receive full postcode yet.
-        return false;
-    }
-
-    // Remove the prefix bytes and combine the partial postcodes together.
-    code.clear();
-    for (size_t i = fullPostPCCCount; i > 0; --i)
-    {
-        code.push_back(aspeedPCCBuffer[i - 1] & pccPostCodeMask);
-    }
-    aspeedPCCBuffer.erase(aspeedPCCBuffer.begin(),
-                          aspeedPCCBuffer.begin() + fullPostPCCCount);
-
-    return true;
-}
-
-/*
- * Callback handling IO event from the POST code fd. i.e. there is new
- * POST code available to read.
- */
-void PostCodeEventHandler(PostReporter* reporter, sdeventplus::source::IO& s,
-                          int postFd, uint32_t)
-{
-    std::vector<uint8_t> code(codeSize, 0);
-    ssize_t readb;
-
-    while ((readb = read(postFd, code.data(), codeSize)) > 0)
-    {
-        if (procPostCode && procPostCode(code, readb) == false)
-        {
-            return;
-        }
-
-        if (verbose)
-        {
-            fprintf(stderr, "Code: 0x");
-            for (const auto& byte : code)
-            {
-                fprintf(stderr, "%02x", byte);
-            }
-            fprintf(stderr, "\n");
-        }
-        // HACK: Always send property changed signal even for the same code
-        // since we are single threaded, external users will never see the
-        // first value.
-        code[0] = ~code[0];
-        reporter->value(std::make_tuple(code, secondary_post_code_t{}), true);
-        code[0] = ~code[0];
-        reporter->value(std::make_tuple(code, secondary_post_code_t{}));
-
-        // read depends on old data being cleared since it doesn't always read
-        // the full code size
-        code.resize(codeSize);
-        std::fill(code.begin(), code.end(), 0);
-
-        if (rateLimit(*reporter, s))
-        {
-            return;
-        }
-    }
-
-    if (readb < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
-    {
-        return;
-    }
-
-    /* Read failure. */
-    if (readb == 0)
-    {
-        fprintf(stderr, "Unexpected EOF reading postcode\n");
-    }
-    else
-    {
-        fprintf(stderr, "Failed to read postcode: %s\n", strerror(errno));
-    }
-    s.get_event().exit(1);
-}
-
 /*
- * TODO(venture): this only listens one of the possible snoop ports, but
- * doesn't share the namespace.
- *
- * This polls() the lpc snoop character device and it owns the dbus object
- * whose value is the latest port 80h value.
+ * This polls() the lpc snoop character devices and it owns the dbus objects
+ * whose value is the latest port 80h value of each of them. All devices
+ * share the bus connection, the service name and the event loop.
  */
 int main(int argc, char* argv[])
 {
-    int postFd = -1;
-    unsigned int rateLimit = 0;
+    SnoopOptions options;
+    std::vector<std::string> devices;
+    std::string decoderName;
+#ifdef ENABLE_IPMI_SNOOP
+    unsigned int displayRate = 0;
+#endif
 
     int opt;
 
@@ -273,10 +161,28 @@ int main(int argc, char* argv[])
     static const struct option long_options[] = {
 #ifdef ENABLE_IPMI_SNOOP
         {"host", optional_argument, NULL, 'h'},
+        {"display-rate", required_argument, NULL, 'R'},
 #else
         {"device", optional_argument, NULL, 'd'},
         {"rate-limit", optional_argument, NULL, 'r'},
+        {"rate-limit-mode", required_argument, NULL, 'm'},
         {"bytes",  required_argument, NULL, 'b'},
+        {"decoder", required_argument, NULL, 'D'},
+        {"bulk-read", no_argument, NULL, 'B'},
+        {"batch-publish", no_argument, NULL, 'P'},
+        {"threaded", no_argument, NULL, 't'},
+        {"timestamps", no_argument, NULL, 'T'},
+        {"rt-priority", required_argument, NULL, 'p'},
+        {"cpu", required_argument, NULL, 'c'},
+        {"mlock", no_argument, NULL, 'M'},
+        {"read-budget", required_argument, NULL, 'w'},
+        {"poll-interval", required_argument, NULL, 'i'},
+        {"poll-threshold", required_argument, NULL, 'I'},
+        {"run-length", required_argument, NULL, 'u'},
+        {"history", required_argument, NULL, 'H'},
+        {"log", required_argument, NULL, 'l'},
+        {"log-size", required_argument, NULL, 'L'},
+        {"stream", required_argument, NULL, 's'},
 #endif
         {"verbose", no_argument, NULL, 'v'},
         {0, 0, 0, 0}
@@ -285,9 +191,9 @@ int main(int argc, char* argv[])
 
     constexpr const char* optstring =
 #ifdef ENABLE_IPMI_SNOOP
-        "h:"
+        "h:R:"
 #else
-        "d:r:b:"
+        "d:r:m:b:D:BPtTp:c:Mw:i:I:u:H:l:L:s:"
 #endif
         "v";
 
@@ -310,57 +216,97 @@ int main(int argc, char* argv[])
                 host.emplace_back(instances);
                 break;
             }
+#ifdef ENABLE_IPMI_SNOOP
+            case 'R':
+                displayRate = parseCount("display rate", optarg, 0);
+                break;
+#endif
             case 'b':
-            {
-                codeSize = atoi(optarg);
-
-                if (codeSize < 1 || codeSize > 8)
-                {
-                    fprintf(stderr,
-                            "Invalid POST code size '%s'. Must be "
-                            "an integer from 1 to 8.\n",
-                            optarg);
-                    exit(EXIT_FAILURE);
-                }
+                options.codeSize =
+                    parseCount("POST code size", optarg, 1, PostCode::maxSize);
+                break;
+            case 'D':
+                decoderName = optarg;
                 break;
-            }
             case 'd':
-                if (std::string(optarg).starts_with("/dev/aspeed-lpc-pcc"))
-                {
-                    procPostCode = aspeedPCC;
-                }
-
-                postFd = open(optarg, O_NONBLOCK);
-                if (postFd < 0)
-                {
-                    fprintf(stderr, "Unable to open: %s\n", optarg);
-                    return -1;
-                }
+                devices.emplace_back(optarg);
                 break;
             case 'r':
-            {
-                int argVal = -1;
-                try
+                options.rateLimit = parseCount("rate limit", optarg, 1);
+                fprintf(stderr, "Rate limiting to %u POST codes per second.\n",
+                        options.rateLimit);
+                break;
+            case 'B':
+                options.bulkRead = true;
+                break;
+            case 'P':
+                options.batchPublish = true;
+                break;
+            case 't':
+                options.threadedRead = true;
+                break;
+            case 'T':
+                options.timestamps = true;
+                // One more signal per code would defeat the point, the
+                // capture times only go out along with each batch.
+                options.batchPublish = true;
+                break;
+            case 'p':
+                options.rtPriority =
+                    parseCount("real-time priority", optarg, 0, 99);
+                break;
+            case 'c':
+                options.rtCpu = parseCount("CPU", optarg, 0);
+                break;
+            case 'M':
+                options.memLock = true;
+                break;
+            case 'w':
+                options.readBudget = parseCount("read budget", optarg, 0);
+                break;
+            case 'i':
+                options.pollInterval = parseCount("poll interval", optarg, 0);
+                break;
+            case 'I':
+                options.pollThreshold =
+                    parseCount("poll threshold", optarg, 1);
+                break;
+            case 'u':
+                options.runLength =
+                    parseCount("run-length interval", optarg, 0);
+                break;
+            case 'H':
+                options.historySize = parseCount("history size", optarg, 0);
+                break;
+            case 'l':
+                options.logPath = optarg;
+                break;
+            case 'L':
+                options.logSize = parseCount("log size", optarg, 1);
+                break;
+            case 's':
+                options.streamPath = optarg;
+                break;
+            case 'm':
+                if (std::string_view(optarg) == "coalesce")
                 {
-                    argVal = std::stoi(optarg);
+                    options.rateLimitMode = RateLimiter::Mode::Coalesce;
                 }
-                catch (...)
-                {}
-
-                if (argVal < 1)
+                else if (std::string_view(optarg) == "drop")
                 {
-                    fprintf(stderr, "Invalid rate limit '%s'. Must be >= 1.\n",
+                    options.rateLimitMode = RateLimiter::Mode::Drop;
+                }
+                else
+                {
+                    fprintf(stderr,
+                            "Invalid rate limit mode '%s'. Must be "
+                            "'coalesce' or 'drop'.\n",
                             optarg);
                     return EXIT_FAILURE;
                 }
-
-                rateLimit = static_cast<unsigned int>(argVal);
-                fprintf(stderr, "Rate limiting to %d POST codes per second.\n",
-                        argVal);
                 break;
-            }
             case 'v':
-                verbose = true;
+                options.verbose = true;
                 break;
             default:
                 usage(argv[0]);
@@ -368,41 +314,66 @@ int main(int argc, char* argv[])
         }
     }
 
-    auto bus = sdbusplus::bus::new_default();
+    // The event loop also serves D-Bus, it must never run under SCHED_FIFO.
+    if ((options.rtPriority > 0 || options.rtCpu >= 0) &&
+        !options.threadedRead)
+    {
+        fprintf(stderr, "--rt-priority and --cpu need --threaded.\n");
+        return EXIT_FAILURE;
+    }
 
-#ifdef ENABLE_IPMI_SNOOP
-    std::cout << "Verbose = " << verbose << std::endl;
-    int ret = postCodeIpmiHandler(ipmiSnoopObject, snoopDbus, bus, host);
-    if (ret < 0)
+    // Without a device the object is still published, with no code source.
+    if (devices.empty())
     {
-        fprintf(stderr, "Error in postCodeIpmiHandler\n");
-        return ret;
+        devices.emplace_back();
+    }
+
+    std::vector<Decoder> decoders;
+    for (const auto& device : devices)
+    {
+        std::string name = decoderName;
+        if (name.empty())
+        {
+            name = device.starts_with("/dev/aspeed-lpc-pcc") ? "aspeed-pcc"
+                                                             : "raw";
+        }
+        auto d = makeDecoder(name, options.codeSize);
+        if (!d)
+        {
+            fprintf(stderr, "Unknown decoder '%s' for %zu byte POST codes.\n",
+                    name.c_str(), options.codeSize);
+            return EXIT_FAILURE;
+        }
+        decoders.emplace_back(std::move(*d));
     }
-    return 0;
-#endif
 
-    bool deferSignals = true;
+    auto bus = sdbusplus::bus::new_default();
 
-    // Add systemd object manager.
-    sdbusplus::server::manager_t snoopdManager(bus, snoopObject);
+    std::vector<int> postFds;
+    for (const auto& device : devices)
+    {
+        int postFd = -1;
+        if (!device.empty())
+        {
+            postFd = open(device.c_str(), O_NONBLOCK);
+            if (postFd < 0)
+            {
+                fprintf(stderr, "Unable to open: %s\n", device.c_str());
+                return -1;
+            }
+        }
+        postFds.push_back(postFd);
+    }
 
-    PostReporter reporter(bus, snoopObject, deferSignals);
-    reporter.emit_object_added();
-    bus.request_name(snoopDbus);
+    int ret = 0;
 
-    // Create sdevent and add IO source
+    // Create sdevent and add IO sources, in either mode
     try
     {
         sdeventplus::Event event = sdeventplus::Event::get_default();
-        std::optional<sdeventplus::source::IO> reporterSource;
-        if (postFd > 0)
-        {
-            reporter.rateLimit = rateLimit;
-            reporterSource.emplace(
-                event, postFd, EPOLLIN,
-                std::bind_front(PostCodeEventHandler, &reporter));
-        }
-        // Enable bus to handle incoming IO and bus events
+
+        // Block signals before any reader thread is started so that they are
+        // only ever delivered through the event loop.
         auto intCb = [](sdeventplus::source::Signal& source,
                         const struct signalfd_siginfo*) {
             source.get_event().exit(0);
@@ -412,17 +383,63 @@ int main(int argc, char* argv[])
         stdplus::signal::block(SIGTERM);
         sdeventplus::source::Signal(event, SIGTERM, std::move(intCb))
             .set_floating(true);
-        return sdeventplus::utility::loopWithBus(event, bus);
+
+#ifdef ENABLE_IPMI_SNOOP
+        std::cout << "Verbose = " << options.verbose << std::endl;
+        ret = postCodeIpmiHandler(ipmiSnoopObject, snoopDbus, bus, event,
+                                  host, displayRate);
+        if (ret < 0)
+        {
+            fprintf(stderr, "Error in postCodeIpmiHandler\n");
+        }
+#else
+        std::vector<std::unique_ptr<SnoopDevice>> snoopDevices;
+        for (size_t i = 0; i < devices.size(); i++)
+        {
+            // Each device gets its own log file and stream socket when there
+            // are several.
+            std::string logPath = options.logPath;
+            std::string streamPath = options.streamPath;
+            if (devices.size() > 1)
+            {
+                if (!logPath.empty())
+                {
+                    logPath += "." + std::to_string(i);
+                }
+                if (!streamPath.empty())
+                {
+                    streamPath += "." + std::to_string(i);
+                }
+            }
+
+            snoopDevices.emplace_back(std::make_unique<SnoopDevice>(
+                bus, event, snoopObjectBase + std::to_string(i), postFds[i],
+                std::move(decoders[i]), logPath, streamPath, options));
+        }
+
+        if (options.memLock)
+        {
+            lockMemory();
+        }
+        bus.request_name(snoopDbus);
+
+        // Enable bus to handle incoming IO and bus events
+        ret = sdeventplus::utility::loopWithBus(event, bus);
+#endif
     }
     catch (const std::exception& e)
     {
         fprintf(stderr, "%s\n", e.what());
+        ret = EXIT_FAILURE;
     }
 
-    if (postFd > -1)
+    for (int postFd : postFds)
     {
-        close(postFd);
+        if (postFd > -1)
+        {
+            close(postFd);
+        }
     }
 
-    return 0;
+    return ret;
 }
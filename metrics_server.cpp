@@ -0,0 +1,53 @@
+#include "metrics_server.hpp"
+
+#include "dbus_property.hpp"
+#include "lpcsnoop/snoop.hpp"
+#include "threaded_reader.hpp"
+
+template <auto Get>
+static constexpr auto get = readOnlyProperty<MetricsServer, Get>;
+
+const sdbusplus::vtable::vtable_t MetricsServer::vtable[] = {
+    sdbusplus::vtable::start(),
+    sdbusplus::vtable::property("Reads", "t",
+                                get<counter<&SnoopMetrics::reads>>),
+    sdbusplus::vtable::property("Bytes", "t",
+                                get<counter<&SnoopMetrics::bytes>>),
+    sdbusplus::vtable::property("Codes", "t",
+                                get<counter<&SnoopMetrics::codes>>),
+    sdbusplus::vtable::property("Resyncs", "t",
+                                get<counter<&SnoopMetrics::resyncs>>),
+    sdbusplus::vtable::property(
+        "RateLimitActivations", "t",
+        get<counter<&SnoopMetrics::rateLimitActivations>>),
+    sdbusplus::vtable::property("WouldBlock", "t",
+                                get<counter<&SnoopMetrics::wouldBlock>>),
+    sdbusplus::vtable::property("EndOfFile", "t",
+                                get<counter<&SnoopMetrics::eofs>>),
+    sdbusplus::vtable::property("Latency", "at", get<latency>),
+    sdbusplus::vtable::property("RingDroppedBytes", "t",
+                                get<ringDroppedBytes>),
+    sdbusplus::vtable::property("RingHighWaterMark", "t",
+                                get<ringHighWaterMark>),
+    sdbusplus::vtable::end()};
+
+MetricsServer::MetricsServer(sdbusplus::bus_t& bus, const char* objPath,
+                             const SnoopMetrics& metrics) :
+    metrics(metrics), intf(bus, objPath, snoopMetricsIface, vtable, this)
+{}
+
+uint64_t MetricsServer::ringDroppedBytes(const MetricsServer& server)
+{
+    return server.reader ? server.reader->droppedBytes() : 0;
+}
+
+uint64_t MetricsServer::ringHighWaterMark(const MetricsServer& server)
+{
+    return server.reader ? server.reader->highWaterMark() : 0;
+}
+
+std::vector<uint64_t> MetricsServer::latency(const MetricsServer& server)
+{
+    const auto& counts = server.metrics.latency.bucketCounts();
+    return {counts.begin(), counts.end()};
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "snoop_metrics.hpp"
+
+#include <sdbusplus/bus.hpp>
+#include <sdbusplus/server.hpp>
+#include <sdbusplus/vtable.hpp>
+
+#include <cstdint>
+#include <vector>
+
+class ThreadedReader;
+
+/*
+ * Serves the SnoopMetrics of a snoop device as read-only properties of the
+ * metrics interface. Like RateLimitServer, the properties are read on demand
+ * and never signal changes.
+ */
+class MetricsServer
+{
+  public:
+    MetricsServer(sdbusplus::bus_t& bus, const char* objPath,
+                  const SnoopMetrics& metrics);
+
+    /* Also serve the ring counters of reader, which must outlive this. */
+    void watchReader(const ThreadedReader& reader)
+    {
+        this->reader = &reader;
+    }
+
+  private:
+    template <uint64_t SnoopMetrics::*Counter>
+    static uint64_t counter(const MetricsServer& server)
+    {
+        return server.metrics.*Counter;
+    }
+    static uint64_t ringDroppedBytes(const MetricsServer& server);
+    static uint64_t ringHighWaterMark(const MetricsServer& server);
+    static std::vector<uint64_t> latency(const MetricsServer& server);
+
+    static const sdbusplus::vtable::vtable_t vtable[];
+
+    const SnoopMetrics& metrics;
+    const ThreadedReader* reader = nullptr;
+    sdbusplus::server::interface_t intf;
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+/*
+ * A POST code of up to 8 bytes, stored inline. This is how codes move from
+ * the decoder through the rate limiter into the history, they are only
+ * turned into the D-Bus representation when published by PostReporter.
+ */
+class PostCode
+{
+  public:
+    static constexpr size_t maxSize = 8;
+
+    PostCode() = default;
+
+    /* Bytes past maxSize are dropped. */
+    explicit PostCode(std::span<const uint8_t> code) :
+        length(std::min(code.size(), maxSize))
+    {
+        std::copy_n(code.begin(), length, data.begin());
+    }
+
+    std::span<const uint8_t> bytes() const
+    {
+        return {data.data(), length};
+    }
+
+    size_t size() const
+    {
+        return length;
+    }
+
+    bool operator==(const PostCode& other) const
+    {
+        return std::ranges::equal(bytes(), other.bytes());
+    }
+
+  private:
+    std::array<uint8_t, maxSize> data{};
+    uint8_t length = 0;
+};
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "post_code.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/*
+ * A POST code as kept in the history. In run-length mode a record stands for
+ * a run of repeats of the code, from timestamp to lastTimestamp.
+ */
+struct PostCodeRecord
+{
+    uint64_t timestamp; /* CLOCK_MONOTONIC, in microseconds */
+    PostCode code;
+    uint64_t lastTimestamp;
+    uint64_t repeats;
+
+    std::span<const uint8_t> bytes() const
+    {
+        return code.bytes();
+    }
+};
+
+/*
+ * Fixed-capacity ring of the most recent POST codes. Every recorded code gets
+ * the next sequence number, so a reader can ask for everything since the last
+ * sequence it saw and tell from the first returned sequence whether codes
+ * were overwritten in between.
+ *
+ * In run-length mode a code equal to the last one updates the last record in
+ * place instead, so the record of a run still going on may change after it
+ * was read.
+ */
+class PostCodeHistory
+{
+  public:
+    /* The capacity is rounded up to a power of two. */
+    explicit PostCodeHistory(size_t capacity, bool runLength = false) :
+        records(std::bit_ceil(std::max<size_t>(capacity, 1))),
+        runLength(runLength)
+    {}
+
+    void record(uint64_t timestamp, std::span<const uint8_t> code)
+    {
+        const PostCode c(code);
+
+        if (runLength && next > 0)
+        {
+            PostCodeRecord& last = records[(next - 1) & (records.size() - 1)];
+            if (last.code == c)
+            {
+                last.lastTimestamp = timestamp;
+                last.repeats++;
+                return;
+            }
+        }
+
+        PostCodeRecord& r = records[next & (records.size() - 1)];
+        r.timestamp = timestamp;
+        r.code = c;
+        r.lastTimestamp = timestamp;
+        r.repeats = 1;
+        next++;
+    }
+
+    /* Sequence number of the oldest record still held. */
+    uint64_t first() const
+    {
+        return next > records.size() ? next - records.size() : 0;
+    }
+
+    /* Sequence number the next recorded code will get. */
+    uint64_t end() const
+    {
+        return next;
+    }
+
+    size_t capacity() const
+    {
+        return records.size();
+    }
+
+    /*
+     * Copy up to max records, starting at sequence from or at the oldest one
+     * still held if from has already been overwritten.
+     *
+     * @return The sequence number of the first record copied into out.
+     */
+    uint64_t range(uint64_t from, size_t max,
+                   std::vector<PostCodeRecord>& out) const
+    {
+        from = std::clamp(from, first(), end());
+        uint64_t to = from + std::min<uint64_t>(max, end() - from);
+
+        out.clear();
+        out.reserve(to - from);
+        for (uint64_t seq = from; seq < to; seq++)
+        {
+            out.push_back(records[seq & (records.size() - 1)]);
+        }
+        return from;
+    }
+
+  private:
+    std::vector<PostCodeRecord> records;
+    bool runLength;
+    uint64_t next = 0;
+};
@@ -0,0 +1,102 @@
+#include "post_code_log.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <system_error>
+
+/* The boot ID of the running kernel, all zero if it cannot be read. */
+static std::array<uint8_t, 16> currentBootId()
+{
+    std::array<uint8_t, 16> id{};
+    std::string uuid;
+    std::ifstream("/proc/sys/kernel/random/boot_id") >> uuid;
+
+    // xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx
+    std::erase(uuid, '-');
+    if (uuid.size() != 2 * id.size())
+    {
+        return {};
+    }
+    for (size_t i = 0; i < id.size(); i++)
+    {
+        try
+        {
+            id[i] = std::stoul(uuid.substr(2 * i, 2), nullptr, 16);
+        }
+        catch (...)
+        {
+            return {};
+        }
+    }
+    return id;
+}
+
+PostCodeLog::PostCodeLog(const std::string& path, uint32_t capacity) :
+    mapSize(sizeof(PostCodeLogHeader) +
+            sizeof(PostCodeLogRecord) * static_cast<size_t>(capacity))
+{
+    if (capacity == 0)
+    {
+        throw std::system_error(EINVAL, std::generic_category(), path);
+    }
+
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        throw std::system_error(errno, std::generic_category(), path);
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 ||
+        (static_cast<size_t>(st.st_size) != mapSize &&
+         ftruncate(fd, mapSize) < 0))
+    {
+        int err = errno;
+        close(fd);
+        throw std::system_error(err, std::generic_category(), path);
+    }
+
+    void* map =
+        mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    int err = errno;
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        throw std::system_error(err, std::generic_category(), path);
+    }
+
+    header = static_cast<PostCodeLogHeader*>(map);
+    records = reinterpret_cast<PostCodeLogRecord*>(header + 1);
+
+    if (header->magic != magic || header->version != version ||
+        header->recordSize != sizeof(PostCodeLogRecord) ||
+        header->capacity != capacity)
+    {
+        std::memset(map, 0, mapSize);
+        header->version = version;
+        header->recordSize = sizeof(PostCodeLogRecord);
+        header->capacity = capacity;
+        header->magic = magic;
+    }
+
+    const auto bootId = currentBootId();
+    if (std::memcmp(header->bootId, bootId.data(), bootId.size()) != 0)
+    {
+        header->bootStart = header->next.load(std::memory_order_relaxed);
+        std::memcpy(header->bootId, bootId.data(), bootId.size());
+    }
+}
+
+PostCodeLog::~PostCodeLog()
+{
+    msync(header, mapSize, MS_ASYNC);
+    munmap(header, mapSize);
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+
+/* On-disk header of the POST code log, at the start of the file. */
+struct PostCodeLogHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t recordSize;
+    uint32_t capacity;
+    /* Sequence number of the next record, published after the record. */
+    std::atomic<uint64_t> next;
+    /* Boot ID of the boot the latest records were written in. */
+    uint8_t bootId[16];
+    /* Sequence number of the first record written in that boot. */
+    uint64_t bootStart;
+    uint8_t reserved[16];
+};
+
+/* On-disk POST code record. sequence lets recovery reject stale slots. */
+struct PostCodeLogRecord
+{
+    uint64_t sequence;
+    uint64_t timestamp; /* CLOCK_MONOTONIC, in microseconds */
+    uint8_t size;
+    uint8_t code[8];
+    uint8_t reserved[7];
+
+    std::span<const uint8_t> bytes() const
+    {
+        return {code, size};
+    }
+};
+
+static_assert(sizeof(PostCodeLogHeader) == 64);
+static_assert(sizeof(PostCodeLogRecord) == 32);
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+/*
+ * Persistent ring of POST codes backed by a memory-mapped file. Appending is
+ * a handful of plain stores into the shared mapping, so the page cache keeps
+ * the codes if snoopd crashes and the file can be read back on restart.
+ */
+class PostCodeLog
+{
+  public:
+    static constexpr uint32_t magic = 0x474c4350; /* "PCLG" */
+    static constexpr uint32_t version = 2;
+    /* Sequence of a slot being rewritten, never a valid one. */
+    static constexpr uint64_t invalidSequence = UINT64_MAX;
+
+    /*
+     * Map the log at path, holding up to capacity records. An existing log
+     * with a matching layout is kept and appended to, anything else is
+     * reinitialized.
+     *
+     * @throws std::system_error if the file cannot be opened or mapped.
+     */
+    PostCodeLog(const std::string& path, uint32_t capacity);
+    ~PostCodeLog();
+    PostCodeLog(const PostCodeLog&) = delete;
+    PostCodeLog& operator=(const PostCodeLog&) = delete;
+
+    void append(uint64_t timestamp, std::span<const uint8_t> code)
+    {
+        const uint64_t seq = header->next.load(std::memory_order_relaxed);
+        PostCodeLogRecord& r = records[seq % header->capacity];
+
+        // Invalidate the slot before touching its data, so a crash half way
+        // through never leaves the new data under the old sequence.
+        r.sequence = invalidSequence;
+        std::atomic_signal_fence(std::memory_order_release);
+        r.timestamp = timestamp;
+        r.size = std::min(code.size(), sizeof(r.code));
+        std::copy_n(code.begin(), r.size, r.code);
+        std::atomic_signal_fence(std::memory_order_release);
+        r.sequence = seq;
+        header->next.store(seq + 1, std::memory_order_release);
+    }
+
+    /*
+     * Sequence number of the first record written since the current boot.
+     * Older records have CLOCK_MONOTONIC timestamps of a previous boot.
+     */
+    uint64_t bootStart() const
+    {
+        return header->bootStart;
+    }
+
+    /* Call f on every valid record still held, oldest first. */
+    template <typename F>
+    void forEach(F&& f) const
+    {
+        const uint64_t end = header->next.load(std::memory_order_acquire);
+        const uint64_t cap = header->capacity;
+
+        for (uint64_t seq = end > cap ? end - cap : 0; seq < end; seq++)
+        {
+            const PostCodeLogRecord& r = records[seq % cap];
+            if (r.sequence == seq && r.size <= sizeof(r.code))
+            {
+                f(r);
+            }
+        }
+    }
+
+  private:
+    PostCodeLogHeader* header = nullptr;
+    PostCodeLogRecord* records = nullptr;
+    size_t mapSize = 0;
+};
@@ -0,0 +1,28 @@
+#include "rate_limit_server.hpp"
+
+#include "dbus_property.hpp"
+#include "lpcsnoop/snoop.hpp"
+
+template <auto Get>
+static constexpr auto get = readOnlyProperty<RateLimitServer, Get>;
+
+const sdbusplus::vtable::vtable_t RateLimitServer::vtable[] = {
+    sdbusplus::vtable::start(),
+    sdbusplus::vtable::property("Limit", "u", get<limit>),
+    sdbusplus::vtable::property("Passed", "t",
+                                get<counter<&RateLimiter::Counters::passed>>),
+    sdbusplus::vtable::property(
+        "Coalesced", "t", get<counter<&RateLimiter::Counters::coalesced>>),
+    sdbusplus::vtable::property("Dropped", "t",
+                                get<counter<&RateLimiter::Counters::dropped>>),
+    sdbusplus::vtable::end()};
+
+RateLimitServer::RateLimitServer(sdbusplus::bus_t& bus, const char* objPath,
+                                 const RateLimiter& limiter) :
+    limiter(limiter), intf(bus, objPath, snoopRateLimitIface, vtable, this)
+{}
+
+uint32_t RateLimitServer::limit(const RateLimitServer& server)
+{
+    return server.limiter.limit();
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "rate_limiter.hpp"
+
+#include <sdbusplus/bus.hpp>
+#include <sdbusplus/server.hpp>
+#include <sdbusplus/vtable.hpp>
+
+#include <cstdint>
+
+/*
+ * Serves the limit and the passed, coalesced and dropped counts of a
+ * RateLimiter as read-only properties of the rate limit interface. The
+ * properties are read on demand and never signal changes, so counting costs
+ * nothing on the bus.
+ */
+class RateLimitServer
+{
+  public:
+    RateLimitServer(sdbusplus::bus_t& bus, const char* objPath,
+                    const RateLimiter& limiter);
+
+  private:
+    template <uint64_t RateLimiter::Counters::*Counter>
+    static uint64_t counter(const RateLimitServer& server)
+    {
+        return server.limiter.counters().*Counter;
+    }
+    static uint32_t limit(const RateLimitServer& server);
+
+    static const sdbusplus::vtable::vtable_t vtable[];
+
+    const RateLimiter& limiter;
+    sdbusplus::server::interface_t intf;
+};
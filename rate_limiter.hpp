@@ -0,0 +1,151 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+/*
+ * Token bucket limiting how many POST codes per second are published. The
+ * bucket holds up to one second worth of codes and refills continuously.
+ *
+ * Codes over the limit are either dropped, or coalesced so that only the
+ * latest of them is kept and published once a token is available again. In
+ * both cases the device keeps being drained and every code is accounted for.
+ */
+class RateLimiter
+{
+  public:
+    enum class Mode
+    {
+        Drop,
+        Coalesce,
+    };
+
+    /* What to do with a code offered to admit(). */
+    enum class Action
+    {
+        Pass, /* publish it now */
+        Hold, /* keep it as the latest pending code, see release() */
+        Drop, /* discard it */
+    };
+
+    struct Counters
+    {
+        uint64_t passed = 0;
+        uint64_t coalesced = 0;
+        uint64_t dropped = 0;
+    };
+
+    /*
+     * @param[in] rate - POST codes per second, must be non-zero.
+     * @param[in] mode - what to do with codes over the limit.
+     */
+    RateLimiter(unsigned int rate, Mode mode) :
+        rate(rate), mode(mode), credit(capacity())
+    {}
+
+    /* Offer a code arriving at now (CLOCK_MONOTONIC, usec). */
+    Action admit(uint64_t now)
+    {
+        if (take(now))
+        {
+            // A code published after a held one supersedes it.
+            if (holding)
+            {
+                holding = false;
+                counts.coalesced++;
+            }
+            counts.passed++;
+            return Action::Pass;
+        }
+
+        if (mode == Mode::Drop)
+        {
+            counts.dropped++;
+            return Action::Drop;
+        }
+
+        if (holding)
+        {
+            counts.coalesced++;
+        }
+        holding = true;
+        return Action::Hold;
+    }
+
+    /*
+     * Try to publish the held code at now.
+     *
+     * @return Whether the held code may be published now.
+     */
+    bool release(uint64_t now)
+    {
+        if (!holding || !take(now))
+        {
+            return false;
+        }
+
+        holding = false;
+        counts.passed++;
+        return true;
+    }
+
+    /* Whether a code is held waiting for release(). */
+    bool pending() const
+    {
+        return holding;
+    }
+
+    /* Earliest time (CLOCK_MONOTONIC, usec) a token is available. */
+    uint64_t nextToken() const
+    {
+        if (credit >= cost)
+        {
+            return last;
+        }
+        return last + (cost - credit + rate - 1) / rate;
+    }
+
+    unsigned int limit() const
+    {
+        return rate;
+    }
+
+    const Counters& counters() const
+    {
+        return counts;
+    }
+
+  private:
+    /* Credit needed per code; the bucket refills rate credits per usec. */
+    static constexpr uint64_t cost = 1000000;
+
+    uint64_t capacity() const
+    {
+        return cost * rate;
+    }
+
+    bool take(uint64_t now)
+    {
+        if (now > last)
+        {
+            // A full second refills the whole bucket, bound the product.
+            uint64_t elapsed = std::min<uint64_t>(now - last, cost);
+            credit = std::min(capacity(), credit + elapsed * rate);
+            last = now;
+        }
+
+        if (credit < cost)
+        {
+            return false;
+        }
+        credit -= cost;
+        return true;
+    }
+
+    uint64_t rate;
+    Mode mode;
+    uint64_t credit;
+    uint64_t last = 0;
+    bool holding = false;
+    Counters counts;
+};
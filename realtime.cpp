@@ -0,0 +1,55 @@
+#include "realtime.hpp"
+
+#include <sched.h>
+#include <sys/mman.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <system_error>
+
+void setRealtime(pthread_t thread, int priority, int cpu)
+{
+    if (cpu >= 0)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+
+        int err = pthread_setaffinity_np(thread, sizeof(set), &set);
+        if (err != 0)
+        {
+            throw std::system_error(err, std::generic_category(),
+                                    "pthread_setaffinity_np");
+        }
+    }
+
+    if (priority > 0)
+    {
+        sched_param param = {};
+        param.sched_priority = priority;
+
+        int err = pthread_setschedparam(thread, SCHED_FIFO, &param);
+        if (err != 0)
+        {
+            throw std::system_error(err, std::generic_category(),
+                                    "pthread_setschedparam");
+        }
+    }
+}
+
+void lockMemory()
+{
+    if (mlockall(MCL_CURRENT | MCL_FUTURE | MCL_ONFAULT) < 0)
+    {
+        throw std::system_error(errno, std::generic_category(), "mlockall");
+    }
+
+    // Touch more stack than the event loop is expected to use.
+    constexpr size_t stackSize = 64 * 1024;
+    [[maybe_unused]] volatile uint8_t stack[stackSize];
+    for (size_t i = 0; i < stackSize; i += 1024)
+    {
+        stack[i] = 0;
+    }
+}
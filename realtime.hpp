@@ -0,0 +1,22 @@
+#pragma once
+
+#include <pthread.h>
+
+/*
+ * Run thread under SCHED_FIFO at priority, unless it is 0, and pin it to cpu,
+ * unless it is negative.
+ *
+ * @throws std::system_error if the kernel refuses, e.g. without CAP_SYS_NICE.
+ */
+void setRealtime(pthread_t thread, int priority, int cpu);
+
+/*
+ * Lock every resident and future page of the process, and fault in the stack
+ * of the calling thread, so the drain path never waits on a page fault. Pages
+ * are locked as they are touched rather than all at once, which would pin
+ * the whole stack mapping of every thread; the drain buffers are filled when
+ * allocated for that reason.
+ *
+ * @throws std::system_error if the memory cannot be locked.
+ */
+void lockMemory();
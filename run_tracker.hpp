@@ -0,0 +1,78 @@
+#pragma once
+
+#include "post_code.hpp"
+
+#include <cstdint>
+
+/*
+ * Tracks the run of the latest POST code for run-length mode. The repeats
+ * of a run are signalled at most once per interval: a repeat arriving once
+ * the interval has passed is due right away, otherwise its count stays
+ * pending until deadline(), or until a different code ends the run.
+ */
+class RunTracker
+{
+  public:
+    /* A count of repeats of code, read from first to last. */
+    struct Run
+    {
+        PostCode code;
+        uint64_t repeats;
+        uint64_t first;
+        uint64_t last;
+    };
+
+    /* @param[in] interval - microseconds between signals of a run. */
+    explicit RunTracker(uint64_t interval) : interval(interval) {}
+
+    /* Whether code repeats the current run. */
+    bool repeats(const PostCode& code) const
+    {
+        return run.repeats > 0 && code == run.code;
+    }
+
+    /*
+     * Account for code, read at now. A repeat extends the current run, any
+     * other code starts a new one, whose pending count must have been taken.
+     */
+    void add(const PostCode& code, uint64_t now)
+    {
+        if (repeats(code))
+        {
+            run.repeats++;
+            run.last = now;
+            waiting = true;
+            return;
+        }
+
+        run = {code, 1, now, now};
+        signalled = now;
+        waiting = false;
+    }
+
+    /* Whether the run has repeats not signalled yet. */
+    bool pending() const
+    {
+        return waiting;
+    }
+
+    /* When the pending repeats are due. */
+    uint64_t deadline() const
+    {
+        return signalled + interval;
+    }
+
+    /* Take the run, signalled at now, clearing its pending repeats. */
+    const Run& take(uint64_t now)
+    {
+        signalled = now;
+        waiting = false;
+        return run;
+    }
+
+  private:
+    uint64_t interval;
+    Run run{PostCode(), 0, 0, 0};
+    uint64_t signalled = 0;
+    bool waiting = false;
+};
@@ -0,0 +1,551 @@
+#include "snoop_device.hpp"
+
+#include "realtime.hpp"
+
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <tuple>
+
+/* Current CLOCK_MONOTONIC time in microseconds. */
+static uint64_t monotonicNow()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+SnoopDevice::SnoopDevice(sdbusplus::bus_t& bus,
+                         const sdeventplus::Event& event,
+                         const std::string& objPath, int postFd,
+                         Decoder decoder, const std::string& logPath,
+                         const std::string& streamPath,
+                         const SnoopOptions& options) :
+    options(options), objPath(objPath), decoder(std::move(decoder)),
+    manager(bus, objPath.c_str()), reporter(bus, objPath.c_str(), true),
+    metricsServer(bus, objPath.c_str(), metrics),
+    bulkBuffer(sysconf(_SC_PAGESIZE))
+{
+    if (options.batchPublish)
+    {
+        reporter.enableBatch();
+    }
+    if (options.timestamps)
+    {
+        reporter.enableTimestamps();
+    }
+    if (options.runLength > 0)
+    {
+        runs.emplace(options.runLength * uint64_t(1000));
+        reporter.enableRuns();
+    }
+    if (options.historySize > 0)
+    {
+        history.emplace(bus, objPath.c_str(), options.historySize,
+                        options.runLength > 0);
+    }
+    if (options.rateLimit > 0)
+    {
+        limiter.emplace(options.rateLimit, options.rateLimitMode);
+        rateLimitServer.emplace(bus, objPath.c_str(), *limiter);
+    }
+    if (!logPath.empty())
+    {
+        codeLog.emplace(logPath, options.logSize);
+
+        // Recover the codes captured before a restart. Those of a previous
+        // boot have timestamps from another CLOCK_MONOTONIC, leave them out.
+        if (history)
+        {
+            codeLog->forEach([this](const PostCodeLogRecord& r) {
+                if (r.sequence >= codeLog->bootStart())
+                {
+                    history->record(r.timestamp, r.bytes());
+                }
+            });
+        }
+    }
+    if (!streamPath.empty())
+    {
+        stream.emplace(event, streamPath);
+    }
+    reporter.emit_object_added();
+
+    if (limiter)
+    {
+        releaseTimer.emplace(
+            event, MonotonicTime::TimePoint(), std::chrono::milliseconds(1),
+            [this](MonotonicTime&, MonotonicTime::TimePoint) {
+                releaseHeldPostCode();
+            });
+        releaseTimer->set_enabled(sdeventplus::source::Enabled::Off);
+    }
+    if (runs)
+    {
+        runTimer.emplace(event, MonotonicTime::TimePoint(),
+                         std::chrono::milliseconds(1),
+                         [this](MonotonicTime&, MonotonicTime::TimePoint) {
+                             signalRun(monotonicNow());
+                         });
+        runTimer->set_enabled(sdeventplus::source::Enabled::Off);
+    }
+    if (postFd >= 0)
+    {
+        int fd = postFd;
+        drainHandler = options.bulkRead
+                           ? &SnoopDevice::postCodeBulkEventHandler
+                           : &SnoopDevice::postCodeEventHandler;
+        if (options.threadedRead)
+        {
+            reader.emplace(postFd);
+            setRealtime(reader->nativeHandle(), options.rtPriority,
+                        options.rtCpu);
+            fd = reader->notifyFd();
+            metricsServer.watchReader(*reader);
+            drainHandler = &SnoopDevice::postCodeRingEventHandler;
+        }
+
+        if (options.pollInterval > 0)
+        {
+            ioSource.emplace(
+                event, fd, EPOLLIN,
+                std::bind_front(&SnoopDevice::adaptiveEventHandler, this));
+            pollTimer.emplace(
+                event, MonotonicTime::TimePoint(), std::chrono::milliseconds(1),
+                [this](MonotonicTime&, MonotonicTime::TimePoint) {
+                    pollDrain();
+                });
+            pollTimer->set_enabled(sdeventplus::source::Enabled::Off);
+        }
+        else
+        {
+            ioSource.emplace(event, fd, EPOLLIN,
+                             std::bind_front(drainHandler, this));
+        }
+    }
+    if (options.batchPublish)
+    {
+        // Post sources run after any other source dispatched in the same
+        // iteration, so every code decoded in it goes out together.
+        batchSource.emplace(event, [this](sdeventplus::source::EventBase&) {
+            reporter.flush();
+
+            const uint64_t now = monotonicNow();
+            for (uint64_t readTime : batchTimes)
+            {
+                metrics.latency.record(now - readTime);
+            }
+            batchTimes.clear();
+        });
+    }
+}
+
+/*
+ * Account for a decoded POST code read at now, whether or not the rate limit
+ * lets it through to D-Bus.
+ */
+void SnoopDevice::recordPostCode(std::span<const uint8_t> code, uint64_t now)
+{
+    if (options.verbose)
+    {
+        fprintf(stderr, "%s Code: 0x", objPath.c_str());
+        for (const auto& byte : code)
+        {
+            fprintf(stderr, "%02x", byte);
+        }
+        fprintf(stderr, "\n");
+    }
+
+    if (history)
+    {
+        history->record(now, code);
+    }
+    if (codeLog)
+    {
+        codeLog->append(now, code);
+    }
+    if (stream)
+    {
+        stream->publish(now, code);
+    }
+}
+
+/*
+ * Publish a single decoded POST code, read at readTime, on the reporter
+ * object. In batch mode the code is only queued, and flushed once per event
+ * loop iteration.
+ */
+void SnoopDevice::emitPostCode(const PostCode& code, uint64_t readTime)
+{
+    if (reporter.timestamping())
+    {
+        reporter.captured(readTime, code.bytes());
+    }
+
+    if (reporter.batching())
+    {
+        reporter.queue(code.bytes());
+        batchTimes.push_back(readTime);
+        return;
+    }
+
+    // The D-Bus representation is only built here, on the way out.
+    primary_post_code_t primary(code.bytes().begin(), code.bytes().end());
+
+    // HACK: Always send property changed signal even for the same code
+    // since we are single threaded, external users will never see the
+    // first value.
+    primary[0] = ~primary[0];
+    reporter.value(std::make_tuple(primary, secondary_post_code_t{}), true);
+    primary[0] = ~primary[0];
+    reporter.value(
+        std::make_tuple(std::move(primary), secondary_post_code_t{}));
+
+    metrics.latency.record(monotonicNow() - readTime);
+}
+
+/* Count the rate limit kicking in, not every code it holds or drops. */
+void SnoopDevice::countRateLimit()
+{
+    if (!rateLimiting)
+    {
+        metrics.rateLimitActivations++;
+        rateLimiting = true;
+    }
+}
+
+/*
+ * Publish code, read at now, unless the rate limit holds it back for later
+ * or drops it.
+ */
+void SnoopDevice::admitPostCode(const PostCode& code, uint64_t now)
+{
+    if (limiter)
+    {
+        switch (limiter->admit(now))
+        {
+            case RateLimiter::Action::Pass:
+                rateLimiting = false;
+                break;
+            case RateLimiter::Action::Hold:
+                countRateLimit();
+                heldCode = code;
+                heldTime = now;
+                scheduleHeldPostCode();
+                return;
+            case RateLimiter::Action::Drop:
+                countRateLimit();
+                return;
+        }
+    }
+
+    emitPostCode(code, now);
+}
+
+/*
+ * Account for code in run-length mode. Repeats of the current run are only
+ * signalled as Repeated, at most once per run-length interval, and Value is
+ * left alone. Any other code ends the run.
+ *
+ * @return Whether code was a repeat, and needs no further publishing.
+ */
+bool SnoopDevice::extendRun(const PostCode& code, uint64_t now)
+{
+    if (!runs->repeats(code))
+    {
+        // Signal the final count of the run this code ends.
+        signalRun(now);
+        runTimer->set_enabled(sdeventplus::source::Enabled::Off);
+        runs->add(code, now);
+        return false;
+    }
+
+    const bool armed = runs->pending();
+    runs->add(code, now);
+    if (now >= runs->deadline())
+    {
+        signalRun(now);
+        runTimer->set_enabled(sdeventplus::source::Enabled::Off);
+    }
+    else if (!armed)
+    {
+        // Signal the count even if the host never sends another code.
+        runTimer->set_time(MonotonicTime::TimePoint(
+            std::chrono::microseconds(runs->deadline())));
+        runTimer->set_enabled(sdeventplus::source::Enabled::OneShot);
+    }
+    return true;
+}
+
+/* Signal the repeats of the current run not signalled yet, if any. */
+void SnoopDevice::signalRun(uint64_t now)
+{
+    if (runs->pending())
+    {
+        const RunTracker::Run& run = runs->take(now);
+        reporter.repeated(run.code.bytes(), run.repeats, run.first, run.last);
+    }
+}
+
+/* Arm the release timer for the code held back by the rate limiter. */
+void SnoopDevice::scheduleHeldPostCode()
+{
+    releaseTimer->set_time(MonotonicTime::TimePoint(
+        std::chrono::microseconds(limiter->nextToken())));
+    releaseTimer->set_enabled(sdeventplus::source::Enabled::OneShot);
+}
+
+/* Publish the held code once the rate limiter has a token for it. */
+void SnoopDevice::releaseHeldPostCode()
+{
+    if (limiter->release(monotonicNow()))
+    {
+        emitPostCode(heldCode, heldTime);
+    }
+    else if (limiter->pending())
+    {
+        scheduleHeldPostCode();
+    }
+}
+
+/*
+ * Decode the raw bytes read from the POST code fd at now and publish every
+ * complete POST code in them, subject to the rate limit.
+ */
+void SnoopDevice::publishPostCodes(std::span<const uint8_t> data,
+                                   uint64_t now)
+{
+    auto publish = [&](std::span<const uint8_t> bytes) {
+        const PostCode code(bytes);
+        recordPostCode(code.bytes(), now);
+        metrics.codes++;
+
+        if (runs && extendRun(code, now))
+        {
+            return;
+        }
+
+        admitPostCode(code, now);
+    };
+
+    std::visit(
+        [&](auto& d) {
+            d.decode(data, publish);
+            metrics.resyncs = d.resyncs();
+        },
+        decoder);
+}
+
+/*
+ * Handle the final return value of read() on the POST code fd. Running out of
+ * data is expected, anything else is fatal and stops the event loop.
+ */
+void SnoopDevice::postCodeReadDone(sdeventplus::source::IO& s, ssize_t readb)
+{
+    if (readb < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+    {
+        metrics.wouldBlock++;
+        return;
+    }
+
+    /* Read failure. */
+    if (readb == 0)
+    {
+        metrics.eofs++;
+        fprintf(stderr, "Unexpected EOF reading postcode\n");
+    }
+    else
+    {
+        fprintf(stderr, "Failed to read postcode: %s\n", strerror(errno));
+    }
+    s.get_event().exit(1);
+}
+
+/*
+ * Callback handling IO event from the POST code fd. i.e. there is new
+ * POST code available to read.
+ */
+void SnoopDevice::postCodeEventHandler(sdeventplus::source::IO& s, int postFd,
+                                       uint32_t)
+{
+    std::array<uint8_t, PostCode::maxSize> raw{};
+    ssize_t readb;
+    size_t reads = 0;
+
+    // Read whole decoder units, the device delivers them atomically.
+    const size_t unit = decoderUnit(decoder);
+    const size_t size = (options.codeSize + unit - 1) / unit * unit;
+
+    while ((readb = read(postFd, raw.data(), size)) > 0)
+    {
+        const uint64_t now = monotonicNow();
+        metrics.reads++;
+        metrics.bytes += readb;
+
+        // A short read is zero padded to a whole decoder unit.
+        const size_t padded = (readb + unit - 1) / unit * unit;
+
+        publishPostCodes(std::span(raw).first(padded), now);
+
+        // read depends on old data being cleared since it doesn't always read
+        // the full code size
+        raw.fill(0);
+
+        if (++reads == options.readBudget)
+        {
+            // The fd stays readable, the rest is drained on the next wakeup
+            // once the other event sources had their turn.
+            return;
+        }
+    }
+
+    postCodeReadDone(s, readb);
+}
+
+/*
+ * Wakeup handler of the adaptive drain mode. It drains like the plain handler
+ * but also tracks the wakeup rate. Once that rate reaches the poll threshold,
+ * it switches to draining from pollTimer every poll interval, like NAPI
+ * polling.
+ */
+void SnoopDevice::adaptiveEventHandler(sdeventplus::source::IO& s, int fd,
+                                       uint32_t events)
+{
+    (this->*drainHandler)(s, fd, events);
+
+    const uint64_t now = monotonicNow();
+    const uint64_t elapsed = now - windowStart;
+    wakeups++;
+    if (elapsed < pollWindow)
+    {
+        return;
+    }
+
+    const bool busy = wakeups * 1000000 >= options.pollThreshold * elapsed;
+    windowStart = now;
+    wakeups = 0;
+
+    if (busy)
+    {
+        ioSource->set_enabled(sdeventplus::source::Enabled::Off);
+        schedulePollDrain(now);
+    }
+}
+
+/* Arm pollTimer for the next drain, one poll interval after now. */
+void SnoopDevice::schedulePollDrain(uint64_t now)
+{
+    pollTimer->set_time(MonotonicTime::TimePoint(
+        std::chrono::microseconds(now) +
+        std::chrono::milliseconds(options.pollInterval)));
+    pollTimer->set_enabled(sdeventplus::source::Enabled::OneShot);
+}
+
+/*
+ * Drain whatever arrived since the last poll. A poll that finds nothing
+ * means traffic went quiet, so go back to waking up on data.
+ */
+void SnoopDevice::pollDrain()
+{
+    const uint64_t reads = metrics.reads;
+    (this->*drainHandler)(*ioSource, ioSource->get_fd(), EPOLLIN);
+
+    const uint64_t now = monotonicNow();
+    if (metrics.reads != reads)
+    {
+        schedulePollDrain(now);
+        return;
+    }
+
+    windowStart = now;
+    wakeups = 0;
+    ioSource->set_enabled(sdeventplus::source::Enabled::On);
+}
+
+/*
+ * Publish the POST codes in the readb bytes just appended to bulkBuffer, read
+ * at now. A trailing partial code or PCC word is carried over to the next
+ * call.
+ */
+void SnoopDevice::processBulkBuffer(size_t readb, uint64_t now)
+{
+    const size_t avail = bulkPending + readb;
+    const size_t unit = decoderUnit(decoder);
+    const size_t whole = avail - avail % unit;
+
+    publishPostCodes({bulkBuffer.data(), whole}, now);
+
+    bulkPending = avail - whole;
+    std::memmove(bulkBuffer.data(), bulkBuffer.data() + whole, bulkPending);
+}
+
+/*
+ * Bulk variant of postCodeEventHandler. Each wakeup drains as much as the
+ * snoop FIFO holds into a reusable page-sized buffer and splits it into POST
+ * codes in user space, rather than issuing one read() per code.
+ */
+void SnoopDevice::postCodeBulkEventHandler(sdeventplus::source::IO& s,
+                                           int postFd, uint32_t)
+{
+    ssize_t readb;
+    size_t reads = 0;
+
+    while ((readb = read(postFd, bulkBuffer.data() + bulkPending,
+                         bulkBuffer.size() - bulkPending)) > 0)
+    {
+        metrics.reads++;
+        metrics.bytes += readb;
+        processBulkBuffer(readb, monotonicNow());
+
+        if (++reads == options.readBudget)
+        {
+            return;
+        }
+    }
+
+    postCodeReadDone(s, readb);
+}
+
+/*
+ * Callback handling the wakeup eventfd of the threaded reader, i.e. the
+ * reader thread has put new bytes from the POST code fd into its ring.
+ */
+void SnoopDevice::postCodeRingEventHandler(sdeventplus::source::IO& s, int,
+                                           uint32_t)
+{
+    size_t popped;
+    uint64_t readTime;
+    size_t reads = 0;
+
+    reader->acknowledge();
+    while ((popped = reader->pop({bulkBuffer.data() + bulkPending,
+                                  bulkBuffer.size() - bulkPending},
+                                 readTime)) > 0)
+    {
+        metrics.reads++;
+        metrics.bytes += popped;
+        processBulkBuffer(popped, readTime);
+
+        if (++reads == options.readBudget)
+        {
+            // Come back for the rest on the next event loop iteration.
+            reader->rearm();
+            return;
+        }
+    }
+
+    ssize_t readb;
+    int err;
+    if (reader->failed(readb, err))
+    {
+        errno = err;
+        postCodeReadDone(s, readb);
+    }
+}
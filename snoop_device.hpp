@@ -0,0 +1,154 @@
+#pragma once
+
+#include "decoder.hpp"
+#include "history_server.hpp"
+#include "lpcsnoop/snoop.hpp"
+#include "metrics_server.hpp"
+#include "post_code.hpp"
+#include "post_code_log.hpp"
+#include "rate_limit_server.hpp"
+#include "rate_limiter.hpp"
+#include "run_tracker.hpp"
+#include "snoop_metrics.hpp"
+#include "stream_server.hpp"
+#include "threaded_reader.hpp"
+
+#include <sdbusplus/bus.hpp>
+#include <sdbusplus/server.hpp>
+#include <sdeventplus/clock.hpp>
+#include <sdeventplus/event.hpp>
+#include <sdeventplus/source/event.hpp>
+#include <sdeventplus/source/io.hpp>
+#include <sdeventplus/source/time.hpp>
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+/* Settings shared by every snoop device of the daemon. */
+struct SnoopOptions
+{
+    size_t codeSize = 1; /* Size of each POST code in bytes */
+    bool verbose = false;
+    bool bulkRead = false;
+    bool batchPublish = false;
+    bool threadedRead = false;
+    bool timestamps = false; /* Publish the capture time of each code */
+    /* SCHED_FIFO priority of the drain path, 0 for the default policy. */
+    int rtPriority = 0;
+    int rtCpu = -1;        /* CPU to pin the drain path to, -1 for any */
+    size_t readBudget = 0; /* Reads per wakeup, 0 for no bound */
+    bool memLock = false;  /* Lock the daemon memory, see lockMemory() */
+    /* Milliseconds between drains under load, 0 to always drain on wakeup. */
+    unsigned int pollInterval = 0;
+    /* Wakeups per second that switch to draining every pollInterval. */
+    unsigned int pollThreshold = 1000;
+    /* Milliseconds between publications of a repeated code, 0 for no runs. */
+    unsigned int runLength = 0;
+    unsigned int rateLimit = 0;
+    RateLimiter::Mode rateLimitMode = RateLimiter::Mode::Coalesce;
+    size_t historySize = 0;
+    std::string logPath;
+    uint32_t logSize = 4096;
+    std::string streamPath;
+};
+
+/*
+ * One snoop device and the D-Bus object its POST codes are published on.
+ * Several of them can share a bus connection and an event loop.
+ */
+class SnoopDevice
+{
+  public:
+    /*
+     * @param[in] objPath - object path to publish the POST codes on.
+     * @param[in] postFd - snoop device fd, not owned. When negative only the
+     *                     object is published.
+     * @param[in] decoder - decoder for the data read from postFd.
+     * @param[in] logPath - persistent log file, empty for none.
+     * @param[in] streamPath - stream socket, empty for none.
+     *
+     * @throws std::exception if the device cannot be set up.
+     */
+    SnoopDevice(sdbusplus::bus_t& bus, const sdeventplus::Event& event,
+                const std::string& objPath, int postFd, Decoder decoder,
+                const std::string& logPath, const std::string& streamPath,
+                const SnoopOptions& options);
+    ~SnoopDevice() = default;
+    SnoopDevice(const SnoopDevice&) = delete;
+    SnoopDevice& operator=(const SnoopDevice&) = delete;
+
+  private:
+    using MonotonicTime =
+        sdeventplus::source::Time<sdeventplus::ClockId::Monotonic>;
+
+    void recordPostCode(std::span<const uint8_t> code, uint64_t now);
+    void emitPostCode(const PostCode& code, uint64_t readTime);
+    void countRateLimit();
+    void admitPostCode(const PostCode& code, uint64_t now);
+    bool extendRun(const PostCode& code, uint64_t now);
+    void signalRun(uint64_t now);
+    void scheduleHeldPostCode();
+    void releaseHeldPostCode();
+    void publishPostCodes(std::span<const uint8_t> data, uint64_t now);
+    void processBulkBuffer(size_t readb, uint64_t now);
+    void postCodeReadDone(sdeventplus::source::IO& s, ssize_t readb);
+    void adaptiveEventHandler(sdeventplus::source::IO& s, int fd,
+                              uint32_t events);
+    void schedulePollDrain(uint64_t now);
+    void pollDrain();
+
+    void postCodeEventHandler(sdeventplus::source::IO& s, int postFd,
+                              uint32_t);
+    void postCodeBulkEventHandler(sdeventplus::source::IO& s, int postFd,
+                                  uint32_t);
+    void postCodeRingEventHandler(sdeventplus::source::IO& s, int, uint32_t);
+
+    const SnoopOptions& options;
+    std::string objPath;
+    Decoder decoder;
+    SnoopMetrics metrics;
+
+    sdbusplus::server::manager_t manager;
+    PostReporter reporter;
+    MetricsServer metricsServer;
+    std::optional<HistoryServer> history;
+    std::optional<RateLimiter> limiter;
+    std::optional<RateLimitServer> rateLimitServer;
+    std::optional<PostCodeLog> codeLog;
+    std::optional<StreamServer> stream;
+
+    /* Reusable buffer shared by the bulk and threaded drain paths. */
+    std::vector<uint8_t> bulkBuffer;
+    /* Bytes of a partial POST code left at the start of bulkBuffer. */
+    size_t bulkPending = 0;
+    /* The latest code held back by the rate limiter, and its read time. */
+    PostCode heldCode;
+    uint64_t heldTime = 0;
+    /* Whether the rate limit held or dropped the last code it was asked. */
+    bool rateLimiting = false;
+    /* Read times of the codes queued for the next batch. */
+    std::vector<uint64_t> batchTimes;
+    /* Run-length mode: the run of the latest code. */
+    std::optional<RunTracker> runs;
+
+    /* The wakeup rate is checked over windows of this many microseconds. */
+    static constexpr uint64_t pollWindow = 100000;
+
+    std::optional<ThreadedReader> reader;
+    std::optional<sdeventplus::source::IO> ioSource;
+    /* Drains the device, called on ioSource wakeups or by pollTimer. */
+    void (SnoopDevice::*drainHandler)(sdeventplus::source::IO&, int,
+                                      uint32_t) = nullptr;
+    /* Adaptive drain mode: wakeups in the window started at windowStart. */
+    uint64_t wakeups = 0;
+    uint64_t windowStart = 0;
+    std::optional<MonotonicTime> pollTimer;
+    std::optional<sdeventplus::source::Post> batchSource;
+    /* Fires when the rate limiter can publish the code it holds back. */
+    std::optional<MonotonicTime> releaseTimer;
+    /* Fires when the pending repeats of a run are due. */
+    std::optional<MonotonicTime> runTimer;
+};
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "latency_histogram.hpp"
+
+#include <cstdint>
+
+/*
+ * Hot path counters of one snoop device. They are plain integers updated
+ * from the event loop only, and read on demand by MetricsServer.
+ */
+struct SnoopMetrics
+{
+    uint64_t reads = 0;       /* read() calls, or ring pops when threaded */
+    uint64_t bytes = 0;       /* bytes read from the device */
+    uint64_t codes = 0;       /* POST codes decoded */
+    uint64_t resyncs = 0;     /* decoder resyncs, i.e. data dropped */
+    /* Times the rate limit started holding or dropping codes. */
+    uint64_t rateLimitActivations = 0;
+    uint64_t wouldBlock = 0;  /* reads that found the device drained */
+    uint64_t eofs = 0;        /* reads that hit end of file */
+    /* From reading a code to publishing it on D-Bus. */
+    LatencyHistogram latency;
+};
@@ -0,0 +1,446 @@
+/*
+ * Emulates a snoop device for load testing snoopd without hardware. POST
+ * codes from a recorded trace, or synthetic ones, are written into a FIFO or
+ * a pty that snoopd opens through -d, at a configurable rate.
+ */
+
+#include "trace_replay.hpp"
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <sys/stat.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cinttypes>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <string>
+#include <vector>
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void usage(const char* name)
+{
+    fprintf(stderr,
+            "Usage: %s [options] <PATH>\n"
+            "  -f, --trace <FILE>  replay the codes in FILE, one hex code per "
+            "line.\n"
+            "                      Default is a synthetic counter\n"
+            "  -b, --bytes <SIZE>  size of the synthetic codes. Default is 1\n"
+            "  -p, --pcc           frame each code byte as an Aspeed PCC "
+            "0x40-0x43 word\n"
+            "  -r, --rate <N>      write N codes per second, 0 for as fast as "
+            "possible.\n"
+            "                      Default is 1000\n"
+            "  -B, --burst <N>     write the codes N at a time. Default is 1\n"
+            "  -o, --on <MS>       with --off, write for MS milliseconds...\n"
+            "  -O, --off <MS>      ...then pause for MS milliseconds\n"
+            "  -n, --count <N>     stop after N codes. Default is the whole "
+            "trace,\n"
+            "                      or never for synthetic codes\n"
+            "  -l, --loop          replay the trace again when it ends\n"
+            "  -t, --pty           create a pty and print the device path for "
+            "snoopd,\n"
+            "                      instead of writing into the FIFO <PATH>\n\n"
+            "Codes the reader is too slow for are dropped and counted, like "
+            "an overflowing\n"
+            "snoop FIFO.\n",
+            name);
+}
+
+/* Parse a non-negative integer option, exiting on error. */
+static uint64_t parseCount(const char* name, const char* arg)
+{
+    long long val = -1;
+    try
+    {
+        val = std::stoll(arg);
+    }
+    catch (...)
+    {}
+
+    if (val < 0)
+    {
+        fprintf(stderr, "Invalid %s '%s'. Must be >= 0.\n", name, arg);
+        exit(EXIT_FAILURE);
+    }
+    return val;
+}
+
+/*
+ * Write as much of pending as the device takes and drop it from pending.
+ * Returns false on a write error.
+ */
+static bool writePending(int fd, std::vector<uint8_t>& pending)
+{
+    ssize_t w = write(fd, pending.data(), pending.size());
+    if (w < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+    {
+        fprintf(stderr, "Failed to write: %s\n", strerror(errno));
+        return false;
+    }
+    if (w > 0)
+    {
+        pending.erase(pending.begin(), pending.begin() + w);
+    }
+    return true;
+}
+
+static bool loadTrace(const char* path, std::vector<PostCode>& trace)
+{
+    std::ifstream in(path);
+    if (!in)
+    {
+        fprintf(stderr, "Unable to open trace: %s\n", path);
+        return false;
+    }
+
+    std::string line;
+    PostCode code;
+    while (std::getline(in, line))
+    {
+        if (parseTraceLine(line, code))
+        {
+            trace.push_back(code);
+        }
+    }
+    return true;
+}
+
+/* Open the write side of the emulated device, a FIFO or a pty master. */
+static int openDevice(const char* path, bool pty)
+{
+    int fd;
+
+    if (pty)
+    {
+        fd = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+        if (fd < 0 || grantpt(fd) < 0 || unlockpt(fd) < 0)
+        {
+            fprintf(stderr, "Unable to create pty: %s\n", strerror(errno));
+            return -1;
+        }
+
+        // Pass the bytes through untouched.
+        struct termios tio;
+        tcgetattr(fd, &tio);
+        cfmakeraw(&tio);
+        tcsetattr(fd, TCSANOW, &tio);
+
+        printf("%s\n", ptsname(fd));
+        fflush(stdout);
+    }
+    else
+    {
+        if (mkfifo(path, 0600) < 0 && errno != EEXIST)
+        {
+            fprintf(stderr, "Unable to create FIFO %s: %s\n", path,
+                    strerror(errno));
+            return -1;
+        }
+
+        // Blocks until snoopd opens the other end.
+        fd = open(path, O_WRONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            fprintf(stderr, "Unable to open: %s\n", path);
+            return -1;
+        }
+    }
+
+    // Never wait for the reader, see the dropped count instead.
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+static void sleepUntil(const struct timespec& deadline)
+{
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline,
+                           nullptr) == EINTR &&
+           !stopRequested)
+    {}
+}
+
+static void addTime(struct timespec& t, std::chrono::nanoseconds d)
+{
+    auto ns = t.tv_nsec + d.count();
+    t.tv_sec += ns / 1000000000;
+    t.tv_nsec = ns % 1000000000;
+}
+
+int main(int argc, char* argv[])
+{
+    const char* tracePath = nullptr;
+    size_t codeSize = 1;
+    bool pcc = false;
+    uint64_t rate = 1000;
+    uint64_t burst = 1;
+    uint64_t onMs = 0;
+    uint64_t offMs = 0;
+    uint64_t count = 0;
+    bool loop = false;
+    bool pty = false;
+
+    int opt;
+
+    // clang-format off
+    static const struct option long_options[] = {
+        {"trace", required_argument, NULL, 'f'},
+        {"bytes", required_argument, NULL, 'b'},
+        {"pcc", no_argument, NULL, 'p'},
+        {"rate", required_argument, NULL, 'r'},
+        {"burst", required_argument, NULL, 'B'},
+        {"on", required_argument, NULL, 'o'},
+        {"off", required_argument, NULL, 'O'},
+        {"count", required_argument, NULL, 'n'},
+        {"loop", no_argument, NULL, 'l'},
+        {"pty", no_argument, NULL, 't'},
+        {0, 0, 0, 0}
+    };
+    // clang-format on
+
+    while ((opt = getopt_long(argc, argv, "f:b:pr:B:o:O:n:lt", long_options,
+                              NULL)) != -1)
+    {
+        switch (opt)
+        {
+            case 'f':
+                tracePath = optarg;
+                break;
+            case 'b':
+                codeSize = parseCount("code size", optarg);
+                if (codeSize < 1 || codeSize > PostCode::maxSize)
+                {
+                    fprintf(stderr,
+                            "Invalid POST code size '%s'. Must be "
+                            "an integer from 1 to 8.\n",
+                            optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'p':
+                pcc = true;
+                break;
+            case 'r':
+                rate = parseCount("rate", optarg);
+                break;
+            case 'B':
+                burst = std::max<uint64_t>(parseCount("burst", optarg), 1);
+                break;
+            case 'o':
+                onMs = parseCount("on time", optarg);
+                break;
+            case 'O':
+                offMs = parseCount("off time", optarg);
+                break;
+            case 'n':
+                count = parseCount("count", optarg);
+                break;
+            case 'l':
+                loop = true;
+                break;
+            case 't':
+                pty = true;
+                break;
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if (optind + (pty ? 0 : 1) != argc)
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // The PCC has four ports, 0x40 to 0x43, one per code byte.
+    if (pcc && codeSize > 4)
+    {
+        fprintf(stderr, "--pcc only frames POST codes of up to 4 bytes.\n");
+        return EXIT_FAILURE;
+    }
+
+    std::vector<PostCode> trace;
+    if (tracePath)
+    {
+        if (!loadTrace(tracePath, trace))
+        {
+            return EXIT_FAILURE;
+        }
+        if (trace.empty())
+        {
+            fprintf(stderr, "No POST codes in trace: %s\n", tracePath);
+            return EXIT_FAILURE;
+        }
+        if (pcc && std::ranges::any_of(trace, [](const PostCode& code) {
+                return code.bytes().size() > 4;
+            }))
+        {
+            fprintf(stderr, "--pcc only frames POST codes of up to 4 bytes.\n");
+            return EXIT_FAILURE;
+        }
+        if (count == 0 && !loop)
+        {
+            count = trace.size();
+        }
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    struct sigaction sa = {};
+    sa.sa_handler = [](int) { stopRequested = 1; };
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+
+    int fd = openDevice(pty ? nullptr : argv[optind], pty);
+    if (fd < 0)
+    {
+        return EXIT_FAILURE;
+    }
+
+    const auto burstInterval =
+        rate ? std::chrono::nanoseconds(burst * 1000000000 / rate)
+             : std::chrono::nanoseconds(0);
+    const bool dutyCycle = onMs > 0 && offMs > 0;
+
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    struct timespec phaseEnd = next;
+    addTime(phaseEnd, std::chrono::milliseconds(onMs));
+
+    std::vector<uint8_t> buffer;
+    // End offset of each code in buffer.
+    std::vector<size_t> ends;
+    // Tail of a code cut by a short write, written before any other code.
+    std::vector<uint8_t> pending;
+    uint64_t written = 0;
+    uint64_t dropped = 0;
+    uint64_t counter = 0;
+    int ret = EXIT_SUCCESS;
+
+    while (!stopRequested && (count == 0 || written + dropped < count))
+    {
+        uint64_t codes = burst;
+        if (count)
+        {
+            codes = std::min(codes, count - written - dropped);
+        }
+
+        if (!pending.empty() && !writePending(fd, pending))
+        {
+            ret = EXIT_FAILURE;
+            break;
+        }
+
+        buffer.clear();
+        ends.clear();
+        for (uint64_t i = 0; i < codes; i++, counter++)
+        {
+            if (trace.empty())
+            {
+                std::array<uint8_t, PostCode::maxSize> bytes;
+                for (size_t b = 0; b < codeSize; b++)
+                {
+                    bytes[b] = counter >> (8 * (codeSize - 1 - b));
+                }
+                encodePostCode(PostCode({bytes.data(), codeSize}), pcc,
+                               buffer);
+            }
+            else
+            {
+                encodePostCode(trace[counter % trace.size()], pcc, buffer);
+            }
+            ends.push_back(buffer.size());
+        }
+
+        // Whatever did not fit is lost, as in an overflowing device FIFO.
+        // Codes are only ever lost whole: the rest of one cut by a short
+        // write goes out first next time, so later codes never shift.
+        if (!pending.empty())
+        {
+            dropped += codes;
+        }
+        else
+        {
+            ssize_t w = write(fd, buffer.data(), buffer.size());
+            if (w < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                fprintf(stderr, "Failed to write: %s\n", strerror(errno));
+                ret = EXIT_FAILURE;
+                break;
+            }
+
+            const size_t done = std::max<ssize_t>(w, 0);
+            auto cut = std::ranges::upper_bound(ends, done);
+            if (cut != ends.end() &&
+                done > (cut == ends.begin() ? 0 : *(cut - 1)))
+            {
+                pending.assign(buffer.begin() + done, buffer.begin() + *cut);
+                cut++;
+            }
+            const uint64_t full = cut - ends.begin();
+            written += full;
+            dropped += codes - full;
+        }
+
+        if (burstInterval.count())
+        {
+            addTime(next, burstInterval);
+            sleepUntil(next);
+        }
+
+        if (dutyCycle)
+        {
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            if (now.tv_sec > phaseEnd.tv_sec ||
+                (now.tv_sec == phaseEnd.tv_sec &&
+                 now.tv_nsec >= phaseEnd.tv_nsec))
+            {
+                addTime(phaseEnd, std::chrono::milliseconds(offMs));
+                sleepUntil(phaseEnd);
+                clock_gettime(CLOCK_MONOTONIC, &next);
+                phaseEnd = next;
+                addTime(phaseEnd, std::chrono::milliseconds(onMs));
+            }
+        }
+    }
+
+    // Finish the last code, the reader would otherwise wait for its end.
+    while (ret == EXIT_SUCCESS && !stopRequested && !pending.empty())
+    {
+        if (!writePending(fd, pending))
+        {
+            ret = EXIT_FAILURE;
+        }
+        else if (!pending.empty())
+        {
+            clock_gettime(CLOCK_MONOTONIC, &next);
+            addTime(next, std::chrono::milliseconds(1));
+            sleepUntil(next);
+        }
+    }
+
+    fprintf(stderr, "%" PRIu64 " POST codes written, %" PRIu64 " dropped\n",
+            written, dropped);
+
+    // Keep the device open until interrupted, snoopd treats EOF or a hangup
+    // as a device failure.
+    while (!stopRequested)
+    {
+        pause();
+    }
+
+    close(fd);
+    return ret;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <span>
+
+/*
+ * Lock-free single-producer/single-consumer ring of trivially copyable
+ * elements. push() may only be called from one thread and pop() from one
+ * other thread. Capacity must be a power of two so indices can be masked.
+ */
+template <typename T, size_t Capacity>
+class SpscRing
+{
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0,
+                  "SpscRing capacity must be a power of two");
+
+  public:
+    /*
+     * Append all of data, or nothing if there is not enough room left.
+     *
+     * @return Whether data was appended.
+     */
+    bool push(std::span<const T> data)
+    {
+        const size_t t = tail.load(std::memory_order_relaxed);
+        const size_t used = t - head.load(std::memory_order_acquire);
+
+        if (Capacity - used < data.size())
+        {
+            return false;
+        }
+
+        const size_t start = t & (Capacity - 1);
+        const size_t first = std::min(data.size(), Capacity - start);
+        std::copy_n(data.begin(), first, buffer.begin() + start);
+        std::copy(data.begin() + first, data.end(), buffer.begin());
+        tail.store(t + data.size(), std::memory_order_release);
+
+        if (used + data.size() > highWater.load(std::memory_order_relaxed))
+        {
+            highWater.store(used + data.size(), std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    /*
+     * Move up to out.size() elements out of the ring.
+     *
+     * @return The number of elements copied into out.
+     */
+    size_t pop(std::span<T> out)
+    {
+        const size_t h = head.load(std::memory_order_relaxed);
+        const size_t n =
+            std::min(tail.load(std::memory_order_acquire) - h, out.size());
+
+        const size_t start = h & (Capacity - 1);
+        const size_t first = std::min(n, Capacity - start);
+        std::copy_n(buffer.begin() + start, first, out.begin());
+        std::copy_n(buffer.begin(), n - first, out.begin() + first);
+        head.store(h + n, std::memory_order_release);
+
+        return n;
+    }
+
+    size_t size() const
+    {
+        return tail.load(std::memory_order_acquire) -
+               head.load(std::memory_order_acquire);
+    }
+
+    static constexpr size_t capacity()
+    {
+        return Capacity;
+    }
+
+    /* Highest number of elements the ring has held at once. */
+    size_t highWaterMark() const
+    {
+        return highWater.load(std::memory_order_relaxed);
+    }
+
+  private:
+    // Keep the producer and consumer indices on separate cache lines.
+    alignas(64) std::atomic<size_t> head{0};
+    alignas(64) std::atomic<size_t> tail{0};
+    std::atomic<size_t> highWater{0};
+    // Zeroed so its pages are faulted in up front rather than on first push.
+    alignas(64) std::array<T, Capacity> buffer{};
+};
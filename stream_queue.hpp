@@ -0,0 +1,86 @@
+#pragma once
+
+#include "lpcsnoop/stream.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+/*
+ * Bounded queue of the stream records waiting to be sent to one client. When
+ * the client falls behind, new records are dropped rather than queued, and
+ * the next one that fits is preceded by a gap marker with the lost count.
+ */
+template <size_t Capacity>
+class StreamQueue
+{
+    static_assert(Capacity >= 2, "A gap marker and a record must fit");
+
+  public:
+    void push(const lpcsnoop::StreamRecord& r)
+    {
+        if (lost > 0)
+        {
+            if (count + 2 > Capacity)
+            {
+                lost++;
+                return;
+            }
+
+            lpcsnoop::StreamRecord gap{};
+            gap.sequence = lostFrom;
+            gap.timestamp = r.timestamp;
+            gap.lost = lost;
+            append(gap);
+            dropped += lost;
+            lost = 0;
+        }
+        else if (count == Capacity)
+        {
+            lostFrom = r.sequence;
+            lost = 1;
+            return;
+        }
+
+        append(r);
+    }
+
+    /* Up to max of the oldest records, contiguous in memory. */
+    std::span<const lpcsnoop::StreamRecord> front(size_t max) const
+    {
+        return {&records[head], std::min({count, Capacity - head, max})};
+    }
+
+    void pop(size_t n)
+    {
+        head = (head + n) % Capacity;
+        count -= n;
+    }
+
+    bool empty() const
+    {
+        return count == 0;
+    }
+
+    /* Records reported lost through gap markers so far. */
+    uint64_t droppedRecords() const
+    {
+        return dropped;
+    }
+
+  private:
+    void append(const lpcsnoop::StreamRecord& r)
+    {
+        records[(head + count) % Capacity] = r;
+        count++;
+    }
+
+    std::array<lpcsnoop::StreamRecord, Capacity> records;
+    size_t head = 0;
+    size_t count = 0;
+    uint64_t lostFrom = 0;
+    uint32_t lost = 0;
+    uint64_t dropped = 0;
+};
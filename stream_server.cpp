@@ -0,0 +1,161 @@
+#include "stream_server.hpp"
+
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <system_error>
+
+StreamServer::StreamServer(const sdeventplus::Event& event,
+                           const std::string& path) : path(path)
+{
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path))
+    {
+        throw std::system_error(ENAMETOOLONG, std::generic_category(),
+                                path);
+    }
+    std::strcpy(addr.sun_path, path.c_str());
+
+    listenFd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                      0);
+    if (listenFd < 0)
+    {
+        throw std::system_error(errno, std::generic_category(), "socket");
+    }
+
+    // Replace the socket left behind by a previous instance.
+    unlink(path.c_str());
+    if (bind(listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) <
+            0 ||
+        listen(listenFd, maxClients) < 0)
+    {
+        int err = errno;
+        close(listenFd);
+        throw std::system_error(err, std::generic_category(), path);
+    }
+
+    listenSource.emplace(event, listenFd, EPOLLIN,
+                         [this](sdeventplus::source::IO&, int, uint32_t) {
+                             acceptClient();
+                         });
+    // Flushed once per loop iteration, like the batchSource of SnoopDevice.
+    flushSource.emplace(event, [this](sdeventplus::source::EventBase&) {
+        flush();
+    });
+}
+
+StreamServer::~StreamServer()
+{
+    for (auto& client : clients)
+    {
+        client.source.reset();
+        close(client.fd);
+    }
+    listenSource.reset();
+    close(listenFd);
+    unlink(path.c_str());
+}
+
+void StreamServer::publish(uint64_t timestamp, std::span<const uint8_t> code)
+{
+    lpcsnoop::StreamRecord r{};
+    r.sequence = sequence++;
+    r.timestamp = timestamp;
+    r.size = std::min(code.size(), sizeof(r.code));
+    std::copy_n(code.begin(), r.size, r.code);
+
+    for (auto& client : clients)
+    {
+        client.queue.push(r);
+    }
+}
+
+void StreamServer::acceptClient()
+{
+    int fd;
+    while ((fd = accept4(listenFd, nullptr, nullptr,
+                         SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0)
+    {
+        if (clients.size() >= maxClients)
+        {
+            fprintf(stderr, "%s: too many stream clients\n", path.c_str());
+            close(fd);
+            continue;
+        }
+
+        Client& client = clients.emplace_back();
+        client.fd = fd;
+        client.source.emplace(
+            listenSource->get_event(), fd, EPOLLIN,
+            [this, &client](sdeventplus::source::IO&, int, uint32_t events) {
+                clientEvent(client, events);
+            });
+    }
+}
+
+/*
+ * Clients only read. Input or a hangup ends the client, EPOLLOUT resumes a
+ * send that found the socket full.
+ */
+void StreamServer::clientEvent(Client& client, uint32_t events)
+{
+    if (events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+    {
+        client.closed = true;
+        client.source->set_enabled(sdeventplus::source::Enabled::Off);
+        return;
+    }
+
+    client.source->set_events(EPOLLIN);
+    send(client);
+}
+
+/* Send queued records until the queue is empty or the socket is full. */
+void StreamServer::send(Client& client)
+{
+    while (!client.queue.empty())
+    {
+        auto records = client.queue.front(packetRecords);
+        ssize_t sent = ::send(client.fd, records.data(), records.size_bytes(),
+                              MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (sent < 0)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                client.source->set_events(EPOLLIN | EPOLLOUT);
+            }
+            else
+            {
+                client.closed = true;
+            }
+            return;
+        }
+        client.queue.pop(records.size());
+    }
+}
+
+void StreamServer::flush()
+{
+    for (auto it = clients.begin(); it != clients.end();)
+    {
+        if (!it->closed)
+        {
+            send(*it);
+        }
+        if (it->closed)
+        {
+            it->source.reset();
+            close(it->fd);
+            it = clients.erase(it);
+            continue;
+        }
+        ++it;
+    }
+}
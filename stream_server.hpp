@@ -0,0 +1,59 @@
+#pragma once
+
+#include "lpcsnoop/stream.hpp"
+#include "stream_queue.hpp"
+
+#include <sdeventplus/event.hpp>
+#include <sdeventplus/source/event.hpp>
+#include <sdeventplus/source/io.hpp>
+
+#include <cstdint>
+#include <list>
+#include <optional>
+#include <span>
+#include <string>
+
+/*
+ * Streams the POST codes of one snoop device to the clients of a
+ * SOCK_SEQPACKET Unix socket, bypassing D-Bus. Codes are queued per client
+ * and sent once per event loop iteration, as many StreamRecord as fit in
+ * each packet. A client that falls behind loses codes, marked by a gap
+ * record, and never blocks the device.
+ */
+class StreamServer
+{
+  public:
+    /* @throws std::system_error if the socket cannot be set up. */
+    StreamServer(const sdeventplus::Event& event, const std::string& path);
+    ~StreamServer();
+    StreamServer(const StreamServer&) = delete;
+    StreamServer& operator=(const StreamServer&) = delete;
+
+    /* Queue code, read at timestamp, for every client. */
+    void publish(uint64_t timestamp, std::span<const uint8_t> code);
+
+  private:
+    static constexpr size_t maxClients = 16;
+    static constexpr size_t queueSize = 1024;
+    static constexpr size_t packetRecords = 64;
+
+    struct Client
+    {
+        int fd;
+        std::optional<sdeventplus::source::IO> source;
+        StreamQueue<queueSize> queue;
+        bool closed = false;
+    };
+
+    void acceptClient();
+    void clientEvent(Client& client, uint32_t events);
+    void send(Client& client);
+    void flush();
+
+    std::string path;
+    int listenFd;
+    uint64_t sequence = 0;
+    std::list<Client> clients;
+    std::optional<sdeventplus::source::IO> listenSource;
+    std::optional<sdeventplus::source::Post> flushSource;
+};
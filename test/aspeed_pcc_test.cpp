@@ -0,0 +1,82 @@
+#include "aspeed_pcc.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace
+{
+
+using Codes = std::vector<std::vector<uint8_t>>;
+
+std::vector<uint8_t> pccBytes(const std::vector<uint16_t>& words)
+{
+    std::vector<uint8_t> bytes(words.size() * sizeof(uint16_t));
+    std::memcpy(bytes.data(), words.data(), bytes.size());
+    return bytes;
+}
+
+template <size_t Words>
+Codes decode(AspeedPccDecoder<Words>& decoder,
+             const std::vector<uint16_t>& words)
+{
+    Codes codes;
+    decoder.decode(pccBytes(words), [&codes](std::span<const uint8_t> code) {
+        codes.emplace_back(code.begin(), code.end());
+    });
+    return codes;
+}
+
+TEST(AspeedPccDecoderTest, DecodesFullCode)
+{
+    AspeedPccDecoder<4> decoder;
+    EXPECT_EQ(4u, decoder.codeBytes);
+    EXPECT_EQ((Codes{{0xdd, 0xcc, 0xbb, 0xaa}}),
+              decode(decoder, {0x40aa, 0x41bb, 0x42cc, 0x43dd}));
+}
+
+TEST(AspeedPccDecoderTest, DecodesEveryCodeInBuffer)
+{
+    AspeedPccDecoder<4> decoder;
+    EXPECT_EQ((Codes{{0x04, 0x03, 0x02, 0x01}, {0x08, 0x07, 0x06, 0x05}}),
+              decode(decoder, {0x4001, 0x4102, 0x4203, 0x4304, 0x4005, 0x4106,
+                               0x4207, 0x4308}));
+}
+
+TEST(AspeedPccDecoderTest, CompletesCodeAcrossCalls)
+{
+    AspeedPccDecoder<4> decoder;
+    EXPECT_TRUE(decode(decoder, {0x4011, 0x4122}).empty());
+    EXPECT_EQ((Codes{{0x44, 0x33, 0x22, 0x11}}),
+              decode(decoder, {0x4233, 0x4344}));
+}
+
+TEST(AspeedPccDecoderTest, ResyncsOnOutOfSequenceWord)
+{
+    AspeedPccDecoder<4> decoder;
+    // 0x42 is out of sequence after 0x40, the following 0x40 starts over.
+    EXPECT_EQ((Codes{{0x04, 0x03, 0x02, 0x01}}),
+              decode(decoder, {0x40ff, 0x42ff, 0x1234, 0x4001, 0x4102, 0x4203,
+                               0x4304}));
+    EXPECT_EQ(2u, decoder.resyncs());
+}
+
+TEST(AspeedPccDecoderTest, OutOfSequenceFirstPortStartsNewCode)
+{
+    AspeedPccDecoder<4> decoder;
+    EXPECT_EQ((Codes{{0x04, 0x03, 0x02, 0x01}}),
+              decode(decoder, {0x40ff, 0x41ff, 0x4001, 0x4102, 0x4203,
+                               0x4304}));
+}
+
+TEST(AspeedPccDecoderTest, TwoByteCodes)
+{
+    AspeedPccDecoder<2> decoder;
+    EXPECT_EQ((Codes{{0xbb, 0xaa}, {0xdd, 0xcc}}),
+              decode(decoder, {0x40aa, 0x41bb, 0x40cc, 0x41dd}));
+}
+
+} // namespace
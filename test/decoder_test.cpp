@@ -0,0 +1,68 @@
+#include "decoder.hpp"
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace
+{
+
+using Codes = std::vector<std::vector<uint8_t>>;
+
+Codes decode(Decoder& decoder, const std::vector<uint8_t>& data)
+{
+    Codes codes;
+    std::visit(
+        [&](auto& d) {
+            d.decode(data, [&codes](std::span<const uint8_t> code) {
+                codes.emplace_back(code.begin(), code.end());
+            });
+        },
+        decoder);
+    return codes;
+}
+
+TEST(DecoderTest, RawSplitsIntoCodeSizeChunks)
+{
+    auto decoder = makeDecoder("raw", 2);
+    ASSERT_TRUE(decoder);
+    EXPECT_EQ(2u, decoderUnit(*decoder));
+    EXPECT_EQ((Codes{{1, 2}, {3, 4}}), decode(*decoder, {1, 2, 3, 4, 5}));
+}
+
+TEST(DecoderTest, RawPicksSpecializationForEachSize)
+{
+    for (size_t size = 1; size <= 8; size++)
+    {
+        auto decoder = makeDecoder("raw", size);
+        ASSERT_TRUE(decoder);
+        EXPECT_EQ(size - 1, decoder->index());
+    }
+    EXPECT_FALSE(makeDecoder("raw", 0));
+    EXPECT_FALSE(makeDecoder("raw", 9));
+}
+
+TEST(DecoderTest, AspeedPccUsesTwoBytesPerWord)
+{
+    auto decoder = makeDecoder("aspeed-pcc", 8);
+    ASSERT_TRUE(decoder);
+    EXPECT_TRUE(std::holds_alternative<AspeedPccDecoder<4>>(*decoder));
+    EXPECT_EQ(2u, decoderUnit(*decoder));
+}
+
+TEST(DecoderTest, AspeedPccRejectsPartialWords)
+{
+    EXPECT_FALSE(makeDecoder("aspeed-pcc", 1));
+    EXPECT_FALSE(makeDecoder("aspeed-pcc", 3));
+    EXPECT_FALSE(makeDecoder("aspeed-pcc", 0));
+    EXPECT_TRUE(makeDecoder("aspeed-pcc", 2));
+}
+
+TEST(DecoderTest, UnknownNameIsRejected)
+{
+    EXPECT_FALSE(makeDecoder("nuvoton-bpc", 1));
+}
+
+} // namespace
@@ -0,0 +1,35 @@
+#include "latency_histogram.hpp"
+
+#include <cstdint>
+
+#include <gtest/gtest.h>
+
+namespace
+{
+
+TEST(LatencyHistogramTest, CountsIntoPowerOfTwoBuckets)
+{
+    LatencyHistogram histogram;
+    histogram.record(0);
+    histogram.record(1);
+    histogram.record(2);
+    histogram.record(3);
+    histogram.record(1000);
+
+    const auto& counts = histogram.bucketCounts();
+    EXPECT_EQ(1u, counts[0]);
+    EXPECT_EQ(1u, counts[1]);
+    EXPECT_EQ(2u, counts[2]);
+    EXPECT_EQ(1u, counts[10]);
+}
+
+TEST(LatencyHistogramTest, LastBucketTakesOverflow)
+{
+    LatencyHistogram histogram;
+    histogram.record(UINT64_MAX);
+    histogram.record(uint64_t(1) << (LatencyHistogram::buckets - 2));
+
+    EXPECT_EQ(2u, histogram.bucketCounts()[LatencyHistogram::buckets - 1]);
+}
+
+} // namespace
@@ -0,0 +1,106 @@
+#include "post_code_history.hpp"
+
+#include <cstdint>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace
+{
+
+std::vector<uint8_t> bytes(const PostCodeRecord& r)
+{
+    return {r.bytes().begin(), r.bytes().end()};
+}
+
+TEST(PostCodeHistoryTest, CapacityRoundsUpToPowerOfTwo)
+{
+    EXPECT_EQ(8u, PostCodeHistory(5).capacity());
+    EXPECT_EQ(1u, PostCodeHistory(0).capacity());
+}
+
+TEST(PostCodeHistoryTest, RangeReturnsRecordedCodes)
+{
+    PostCodeHistory history(4);
+    history.record(10, std::vector<uint8_t>{0x01});
+    history.record(20, std::vector<uint8_t>{0x02, 0x03});
+
+    std::vector<PostCodeRecord> out;
+    EXPECT_EQ(0u, history.range(0, 16, out));
+    ASSERT_EQ(2u, out.size());
+    EXPECT_EQ(10u, out[0].timestamp);
+    EXPECT_EQ((std::vector<uint8_t>{0x01}), bytes(out[0]));
+    EXPECT_EQ(20u, out[1].timestamp);
+    EXPECT_EQ((std::vector<uint8_t>{0x02, 0x03}), bytes(out[1]));
+}
+
+TEST(PostCodeHistoryTest, RangeStartsAtRequestedSequence)
+{
+    PostCodeHistory history(4);
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        history.record(i, std::vector<uint8_t>{i});
+    }
+
+    std::vector<PostCodeRecord> out;
+    EXPECT_EQ(1u, history.range(1, 1, out));
+    ASSERT_EQ(1u, out.size());
+    EXPECT_EQ((std::vector<uint8_t>{1}), bytes(out[0]));
+
+    EXPECT_EQ(3u, history.range(7, 16, out));
+    EXPECT_TRUE(out.empty());
+}
+
+TEST(PostCodeHistoryTest, RunLengthMergesRepeatedCodes)
+{
+    PostCodeHistory history(4, true);
+    history.record(10, std::vector<uint8_t>{0x01});
+    history.record(20, std::vector<uint8_t>{0x02});
+    history.record(30, std::vector<uint8_t>{0x02});
+    history.record(40, std::vector<uint8_t>{0x02});
+    history.record(50, std::vector<uint8_t>{0x01});
+
+    std::vector<PostCodeRecord> out;
+    EXPECT_EQ(0u, history.range(0, 16, out));
+    ASSERT_EQ(3u, out.size());
+    EXPECT_EQ(1u, out[0].repeats);
+    EXPECT_EQ((std::vector<uint8_t>{0x02}), bytes(out[1]));
+    EXPECT_EQ(3u, out[1].repeats);
+    EXPECT_EQ(20u, out[1].timestamp);
+    EXPECT_EQ(40u, out[1].lastTimestamp);
+    EXPECT_EQ(1u, out[2].repeats);
+    EXPECT_EQ(3u, history.end());
+}
+
+TEST(PostCodeHistoryTest, RepeatsAreSeparateRecordsByDefault)
+{
+    PostCodeHistory history(4);
+    history.record(10, std::vector<uint8_t>{0x02});
+    history.record(20, std::vector<uint8_t>{0x02});
+
+    std::vector<PostCodeRecord> out;
+    history.range(0, 16, out);
+    ASSERT_EQ(2u, out.size());
+    EXPECT_EQ(1u, out[1].repeats);
+    EXPECT_EQ(20u, out[1].lastTimestamp);
+}
+
+TEST(PostCodeHistoryTest, OverwrittenRecordsAreSkipped)
+{
+    PostCodeHistory history(4);
+    for (uint8_t i = 0; i < 6; i++)
+    {
+        history.record(i, std::vector<uint8_t>{i});
+    }
+
+    EXPECT_EQ(2u, history.first());
+    EXPECT_EQ(6u, history.end());
+
+    std::vector<PostCodeRecord> out;
+    EXPECT_EQ(2u, history.range(0, 16, out));
+    ASSERT_EQ(4u, out.size());
+    EXPECT_EQ((std::vector<uint8_t>{2}), bytes(out[0]));
+    EXPECT_EQ((std::vector<uint8_t>{5}), bytes(out[3]));
+}
+
+} // namespace
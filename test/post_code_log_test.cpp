@@ -0,0 +1,125 @@
+#include "post_code_log.hpp"
+
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace
+{
+
+class PostCodeLogTest : public ::testing::Test
+{
+  protected:
+    PostCodeLogTest()
+    {
+        char tmpl[] = "/tmp/post_code_log_test.XXXXXX";
+        int fd = mkstemp(tmpl);
+        close(fd);
+        path = tmpl;
+    }
+
+    ~PostCodeLogTest()
+    {
+        unlink(path.c_str());
+    }
+
+    std::vector<std::vector<uint8_t>> readBack(uint32_t capacity)
+    {
+        PostCodeLog log(path, capacity);
+        std::vector<std::vector<uint8_t>> codes;
+        log.forEach([&codes](const PostCodeLogRecord& r) {
+            codes.emplace_back(r.bytes().begin(), r.bytes().end());
+        });
+        return codes;
+    }
+
+    std::string path;
+};
+
+TEST_F(PostCodeLogTest, NewLogIsEmpty)
+{
+    EXPECT_TRUE(readBack(8).empty());
+}
+
+TEST_F(PostCodeLogTest, CodesSurviveReopen)
+{
+    {
+        PostCodeLog log(path, 8);
+        log.append(1, std::vector<uint8_t>{0x12});
+        log.append(2, std::vector<uint8_t>{0x34, 0x56});
+    }
+
+    std::vector<std::vector<uint8_t>> expected = {{0x12}, {0x34, 0x56}};
+    EXPECT_EQ(expected, readBack(8));
+}
+
+TEST_F(PostCodeLogTest, KeepsOnlyTheLatestCodes)
+{
+    {
+        PostCodeLog log(path, 4);
+        for (uint8_t i = 0; i < 6; i++)
+        {
+            log.append(i, std::vector<uint8_t>{i});
+        }
+    }
+
+    std::vector<std::vector<uint8_t>> expected = {{2}, {3}, {4}, {5}};
+    EXPECT_EQ(expected, readBack(4));
+}
+
+TEST_F(PostCodeLogTest, ReopenAppendsAfterRecoveredCodes)
+{
+    {
+        PostCodeLog log(path, 8);
+        log.append(1, std::vector<uint8_t>{0x01});
+    }
+    {
+        PostCodeLog log(path, 8);
+        log.append(2, std::vector<uint8_t>{0x02});
+    }
+
+    std::vector<std::vector<uint8_t>> expected = {{0x01}, {0x02}};
+    EXPECT_EQ(expected, readBack(8));
+}
+
+TEST_F(PostCodeLogTest, RecordsOfThisBootStartAtBootStart)
+{
+    {
+        PostCodeLog log(path, 8);
+        log.append(1, std::vector<uint8_t>{0x01});
+    }
+
+    // Pretend the log was written in another boot.
+    {
+        std::fstream file(path, std::ios::in | std::ios::out |
+                                    std::ios::binary);
+        file.seekp(offsetof(PostCodeLogHeader, bootId));
+        file.write("\xff", 1);
+    }
+
+    PostCodeLog log(path, 8);
+    EXPECT_EQ(1u, log.bootStart());
+    log.append(2, std::vector<uint8_t>{0x02});
+
+    PostCodeLog reopened(path, 8);
+    EXPECT_EQ(1u, reopened.bootStart());
+}
+
+TEST_F(PostCodeLogTest, CapacityChangeResetsLog)
+{
+    {
+        PostCodeLog log(path, 8);
+        log.append(1, std::vector<uint8_t>{0x01});
+    }
+
+    EXPECT_TRUE(readBack(16).empty());
+}
+
+} // namespace
@@ -0,0 +1,42 @@
+#include "post_code.hpp"
+
+#include <cstdint>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace
+{
+
+TEST(PostCodeTest, HoldsCodeBytes)
+{
+    const std::vector<uint8_t> bytes = {0x12, 0x34, 0x56};
+    PostCode code(bytes);
+
+    EXPECT_EQ(3u, code.size());
+    EXPECT_EQ(bytes, std::vector<uint8_t>(code.bytes().begin(),
+                                          code.bytes().end()));
+}
+
+TEST(PostCodeTest, DefaultIsEmpty)
+{
+    EXPECT_EQ(0u, PostCode().size());
+    EXPECT_TRUE(PostCode().bytes().empty());
+}
+
+TEST(PostCodeTest, DropsBytesPastMaxSize)
+{
+    const std::vector<uint8_t> bytes(PostCode::maxSize + 2, 0xaa);
+
+    EXPECT_EQ(PostCode::maxSize, PostCode(bytes).size());
+}
+
+TEST(PostCodeTest, ComparesOnlyCodeBytes)
+{
+    EXPECT_EQ(PostCode(std::vector<uint8_t>{0x01, 0x02}),
+              PostCode(std::vector<uint8_t>{0x01, 0x02}));
+    EXPECT_NE(PostCode(std::vector<uint8_t>{0x01}),
+              PostCode(std::vector<uint8_t>{0x01, 0x00}));
+}
+
+} // namespace
@@ -103,4 +103,95 @@ TEST_F(PostReporterTest, SetValueMultipleTimesWorks)
     EXPECT_EQ(secondaryCode, std::get<1>(testReporter.value()));
 }
 
+TEST_F(PostReporterTest, EnableBatchAddsBatchInterface)
+{
+    PostReporter testReporter(bus, snoopObject, true);
+
+    EXPECT_CALL(bus_mock,
+                sd_bus_add_object_vtable(IsNull(), _, StrEq(snoopObject),
+                                         StrEq(snoopBatchIface), _, _))
+        .WillOnce(Return(0));
+
+    testReporter.enableBatch();
+    EXPECT_TRUE(testReporter.batching());
+}
+
+TEST_F(PostReporterTest, FlushSetsValueToLastQueuedCode)
+{
+    PostReporter testReporter(bus, snoopObject, true);
+    testReporter.enableBatch();
+
+    EXPECT_CALL(bus_mock, sd_bus_message_new_signal(IsNull(), _,
+                                                    StrEq(snoopObject),
+                                                    StrEq(snoopBatchIface),
+                                                    StrEq(snoopBatchSignal)))
+        .WillOnce(Return(0));
+
+    testReporter.queue(std::vector<uint8_t>{0x12});
+    testReporter.queue(std::vector<uint8_t>{0x34, 0x56});
+    testReporter.flush();
+    EXPECT_EQ((primary_post_code_t{0x34, 0x56}),
+              std::get<0>(testReporter.value()));
+
+    // Nothing queued, nothing sent.
+    testReporter.flush();
+}
+
+TEST_F(PostReporterTest, TimestampsImplyBatch)
+{
+    PostReporter testReporter(bus, snoopObject, true);
+
+    EXPECT_CALL(bus_mock,
+                sd_bus_add_object_vtable(IsNull(), _, StrEq(snoopObject),
+                                         StrEq(snoopBatchIface), _, _))
+        .WillOnce(Return(0));
+    EXPECT_CALL(bus_mock,
+                sd_bus_add_object_vtable(IsNull(), _, StrEq(snoopObject),
+                                         StrEq(snoopTimestampIface), _, _))
+        .WillOnce(Return(0));
+    testReporter.enableTimestamps();
+    EXPECT_TRUE(testReporter.timestamping());
+    EXPECT_TRUE(testReporter.batching());
+}
+
+TEST_F(PostReporterTest, RepeatedSendsRunSignal)
+{
+    PostReporter testReporter(bus, snoopObject, true);
+
+    EXPECT_CALL(bus_mock,
+                sd_bus_add_object_vtable(IsNull(), _, StrEq(snoopObject),
+                                         StrEq(snoopRunIface), _, _))
+        .WillOnce(Return(0));
+    testReporter.enableRuns();
+
+    EXPECT_CALL(bus_mock, sd_bus_message_new_signal(
+                              IsNull(), _, StrEq(snoopObject),
+                              StrEq(snoopRunIface), StrEq(snoopRunSignal)))
+        .WillOnce(Return(0));
+    testReporter.repeated(std::vector<uint8_t>{0x12}, 3, 10, 30);
+}
+
+TEST_F(PostReporterTest, FlushSendsCapturesWithBatch)
+{
+    PostReporter testReporter(bus, snoopObject, true);
+    testReporter.enableBatch();
+    testReporter.enableTimestamps();
+
+    EXPECT_CALL(bus_mock, sd_bus_message_new_signal(
+                              IsNull(), _, StrEq(snoopObject),
+                              StrEq(snoopTimestampIface),
+                              StrEq(snoopCapturedSignal)))
+        .Times(0);
+    testReporter.queue(std::vector<uint8_t>{0x12});
+    testReporter.captured(1234, std::vector<uint8_t>{0x12});
+    ::testing::Mock::VerifyAndClearExpectations(&bus_mock);
+
+    EXPECT_CALL(bus_mock, sd_bus_message_new_signal(
+                              IsNull(), _, StrEq(snoopObject),
+                              StrEq(snoopTimestampIface),
+                              StrEq(snoopCapturedSignal)))
+        .WillOnce(Return(0));
+    testReporter.flush();
+}
+
 } // namespace
@@ -0,0 +1,63 @@
+#include "rate_limiter.hpp"
+
+#include <gtest/gtest.h>
+
+namespace
+{
+
+using Action = RateLimiter::Action;
+
+TEST(RateLimiterTest, PassesUpToOneSecondOfCodes)
+{
+    RateLimiter limiter(3, RateLimiter::Mode::Drop);
+
+    EXPECT_EQ(Action::Pass, limiter.admit(10));
+    EXPECT_EQ(Action::Pass, limiter.admit(10));
+    EXPECT_EQ(Action::Pass, limiter.admit(10));
+    EXPECT_EQ(Action::Drop, limiter.admit(10));
+    EXPECT_EQ(3u, limiter.counters().passed);
+    EXPECT_EQ(1u, limiter.counters().dropped);
+}
+
+TEST(RateLimiterTest, RefillsOverTime)
+{
+    RateLimiter limiter(2, RateLimiter::Mode::Drop);
+
+    limiter.admit(0);
+    limiter.admit(0);
+    EXPECT_EQ(Action::Drop, limiter.admit(0));
+    EXPECT_EQ(500000u, limiter.nextToken());
+    EXPECT_EQ(Action::Drop, limiter.admit(499999));
+    EXPECT_EQ(Action::Pass, limiter.admit(500000));
+}
+
+TEST(RateLimiterTest, CoalesceKeepsLatestCode)
+{
+    RateLimiter limiter(1, RateLimiter::Mode::Coalesce);
+
+    EXPECT_EQ(Action::Pass, limiter.admit(0));
+    EXPECT_EQ(Action::Hold, limiter.admit(1));
+    EXPECT_EQ(Action::Hold, limiter.admit(2));
+    EXPECT_TRUE(limiter.pending());
+    EXPECT_EQ(1u, limiter.counters().coalesced);
+
+    EXPECT_FALSE(limiter.release(limiter.nextToken() - 1));
+    EXPECT_TRUE(limiter.release(limiter.nextToken()));
+    EXPECT_FALSE(limiter.pending());
+    EXPECT_EQ(2u, limiter.counters().passed);
+    EXPECT_EQ(0u, limiter.counters().dropped);
+}
+
+TEST(RateLimiterTest, PassedCodeSupersedesHeldCode)
+{
+    RateLimiter limiter(1, RateLimiter::Mode::Coalesce);
+
+    limiter.admit(0);
+    EXPECT_EQ(Action::Hold, limiter.admit(1));
+    EXPECT_EQ(Action::Pass, limiter.admit(2000000));
+    EXPECT_FALSE(limiter.pending());
+    EXPECT_EQ(1u, limiter.counters().coalesced);
+    EXPECT_FALSE(limiter.release(3000000));
+}
+
+} // namespace
@@ -0,0 +1,74 @@
+#include "run_tracker.hpp"
+
+#include <gtest/gtest.h>
+
+#include <array>
+
+namespace
+{
+
+const std::array<uint8_t, 1> codeA = {0xa0};
+const std::array<uint8_t, 1> codeB = {0xb0};
+
+TEST(RunTrackerTest, FirstCodeStartsRunWithNothingPending)
+{
+    RunTracker runs(1000);
+
+    EXPECT_FALSE(runs.repeats(PostCode(codeA)));
+    runs.add(PostCode(codeA), 10);
+    EXPECT_TRUE(runs.repeats(PostCode(codeA)));
+    EXPECT_FALSE(runs.repeats(PostCode(codeB)));
+    EXPECT_FALSE(runs.pending());
+}
+
+TEST(RunTrackerTest, TrailingRepeatsAreDueWithoutAnotherCode)
+{
+    RunTracker runs(1000);
+
+    runs.add(PostCode(codeA), 10);
+    runs.add(PostCode(codeA), 20);
+    runs.add(PostCode(codeA), 30);
+
+    // The host then goes quiet: the count is due by the deadline alone.
+    EXPECT_TRUE(runs.pending());
+    EXPECT_EQ(1010u, runs.deadline());
+
+    const RunTracker::Run& run = runs.take(1010);
+    EXPECT_EQ(PostCode(codeA), run.code);
+    EXPECT_EQ(3u, run.repeats);
+    EXPECT_EQ(10u, run.first);
+    EXPECT_EQ(30u, run.last);
+    EXPECT_FALSE(runs.pending());
+    EXPECT_EQ(2010u, runs.deadline());
+}
+
+TEST(RunTrackerTest, RepeatsAfterTakeArePendingAgain)
+{
+    RunTracker runs(1000);
+
+    runs.add(PostCode(codeA), 0);
+    runs.add(PostCode(codeA), 1500);
+    EXPECT_GE(1500u, runs.deadline());
+    EXPECT_EQ(2u, runs.take(1500).repeats);
+
+    runs.add(PostCode(codeA), 1600);
+    EXPECT_TRUE(runs.pending());
+    EXPECT_EQ(2500u, runs.deadline());
+    EXPECT_EQ(3u, runs.take(2500).repeats);
+}
+
+TEST(RunTrackerTest, OtherCodeStartsNewRun)
+{
+    RunTracker runs(1000);
+
+    runs.add(PostCode(codeA), 0);
+    runs.add(PostCode(codeA), 10);
+    EXPECT_EQ(2u, runs.take(20).repeats);
+
+    runs.add(PostCode(codeB), 30);
+    EXPECT_FALSE(runs.pending());
+    EXPECT_TRUE(runs.repeats(PostCode(codeB)));
+    EXPECT_EQ(1030u, runs.deadline());
+}
+
+} // namespace
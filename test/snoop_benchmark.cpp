@@ -0,0 +1,147 @@
+#include "decoder.hpp"
+#include "lpcsnoop/snoop.hpp"
+#include "snoop_device.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <sdbusplus/bus.hpp>
+#include <sdbusplus/test/sdbus_mock.hpp>
+#include <sdeventplus/event.hpp>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <gmock/gmock.h>
+
+using ::testing::NiceMock;
+
+namespace
+{
+
+/* A page of PCC words framing consecutive 4-word POST codes. */
+std::vector<uint8_t> pccFrames()
+{
+    std::vector<uint8_t> data;
+    for (size_t i = 0; data.size() < 4096; i++)
+    {
+        for (uint8_t w = 0; w < 4; w++)
+        {
+            data.push_back(static_cast<uint8_t>(i >> (8 * w)));
+            data.push_back(0x40 + w);
+        }
+    }
+    return data;
+}
+
+void BM_AspeedPccDecode(benchmark::State& state)
+{
+    const auto data = pccFrames();
+    AspeedPccDecoder<4> decoder;
+    size_t codes = 0;
+
+    for (auto _ : state)
+    {
+        decoder.decode(data, [&](std::span<const uint8_t> code) {
+            benchmark::DoNotOptimize(code.data());
+            codes++;
+        });
+    }
+
+    state.SetBytesProcessed(state.iterations() * data.size());
+    state.SetItemsProcessed(codes);
+}
+BENCHMARK(BM_AspeedPccDecode);
+
+/* The same decode, dispatched through the runtime selected Decoder. */
+void BM_DecoderVisit(benchmark::State& state)
+{
+    const auto data = pccFrames();
+    Decoder decoder = *makeDecoder("aspeed-pcc", 8);
+    size_t codes = 0;
+
+    for (auto _ : state)
+    {
+        std::visit(
+            [&](auto& d) {
+                d.decode(data, [&](std::span<const uint8_t> code) {
+                    benchmark::DoNotOptimize(code.data());
+                    codes++;
+                });
+            },
+            decoder);
+    }
+
+    state.SetBytesProcessed(state.iterations() * data.size());
+    state.SetItemsProcessed(codes);
+}
+BENCHMARK(BM_DecoderVisit);
+
+/*
+ * Drain a pipe standing in for the snoop device through the whole read,
+ * decode and publish path of SnoopDevice, against a mocked bus. The argument
+ * selects the bulk read path.
+ */
+void BM_SnoopDeviceDrain(benchmark::State& state)
+{
+    NiceMock<sdbusplus::SdBusMock> busMock;
+    auto bus = sdbusplus::get_mocked_new(&busMock);
+    auto event = sdeventplus::Event::get_new();
+
+    int fds[2];
+    if (pipe2(fds, O_NONBLOCK | O_CLOEXEC) < 0)
+    {
+        state.SkipWithError("pipe2 failed");
+        return;
+    }
+
+    SnoopOptions options;
+    options.bulkRead = state.range(0);
+
+    const std::vector<uint8_t> codes(1024, 0x5a);
+    {
+        SnoopDevice device(bus, event, snoopObject, fds[0],
+                           *makeDecoder("raw", 1), "", "", options);
+
+        for (auto _ : state)
+        {
+            if (write(fds[1], codes.data(), codes.size()) !=
+                static_cast<ssize_t>(codes.size()))
+            {
+                state.SkipWithError("write failed");
+                break;
+            }
+            event.run(std::chrono::microseconds(0));
+        }
+    }
+
+    close(fds[0]);
+    close(fds[1]);
+    state.SetItemsProcessed(state.iterations() * codes.size());
+}
+BENCHMARK(BM_SnoopDeviceDrain)->Arg(0)->Arg(1);
+
+void BM_PostReporterValue(benchmark::State& state)
+{
+    NiceMock<sdbusplus::SdBusMock> busMock;
+    auto bus = sdbusplus::get_mocked_new(&busMock);
+    PostReporter reporter(bus, snoopObject, true);
+    uint8_t code = 0;
+
+    for (auto _ : state)
+    {
+        reporter.value(std::make_tuple(primary_post_code_t{code++},
+                                       secondary_post_code_t{}));
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PostReporterValue);
+
+} // namespace
+
+BENCHMARK_MAIN();
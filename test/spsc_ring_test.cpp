@@ -0,0 +1,104 @@
+#include "spsc_ring.hpp"
+
+#include <array>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace
+{
+
+TEST(SpscRingTest, PopsWhatWasPushed)
+{
+    SpscRing<uint8_t, 8> ring;
+    std::array<uint8_t, 3> in = {1, 2, 3};
+    std::array<uint8_t, 8> out{};
+
+    EXPECT_TRUE(ring.push(in));
+    EXPECT_EQ(3u, ring.size());
+    EXPECT_EQ(3u, ring.pop(out));
+    EXPECT_EQ(1, out[0]);
+    EXPECT_EQ(2, out[1]);
+    EXPECT_EQ(3, out[2]);
+    EXPECT_EQ(0u, ring.pop(out));
+}
+
+TEST(SpscRingTest, RejectsPushThatDoesNotFit)
+{
+    SpscRing<uint8_t, 4> ring;
+    std::array<uint8_t, 3> in = {1, 2, 3};
+
+    EXPECT_TRUE(ring.push(in));
+    EXPECT_FALSE(ring.push(in));
+    EXPECT_EQ(3u, ring.size());
+}
+
+TEST(SpscRingTest, WrapsAroundTheEnd)
+{
+    SpscRing<uint8_t, 4> ring;
+    std::array<uint8_t, 3> in = {1, 2, 3};
+    std::array<uint8_t, 3> out{};
+
+    ASSERT_TRUE(ring.push(in));
+    ASSERT_EQ(3u, ring.pop(out));
+
+    in = {4, 5, 6};
+    ASSERT_TRUE(ring.push(in));
+    ASSERT_EQ(3u, ring.pop(out));
+    EXPECT_EQ(in, out);
+}
+
+TEST(SpscRingTest, TracksHighWaterMark)
+{
+    SpscRing<uint8_t, 8> ring;
+    std::array<uint8_t, 3> in = {1, 2, 3};
+    std::array<uint8_t, 8> out{};
+
+    ring.push(in);
+    ring.push(in);
+    ring.pop(out);
+    ring.push(in);
+    EXPECT_EQ(6u, ring.highWaterMark());
+}
+
+TEST(SpscRingTest, ConcurrentProducerAndConsumerKeepOrder)
+{
+    constexpr uint32_t count = 10000;
+    SpscRing<uint32_t, 64> ring;
+
+    std::thread producer([&ring]() {
+        for (uint32_t i = 0; i < count;)
+        {
+            if (ring.push(std::span<const uint32_t>(&i, 1)))
+            {
+                i++;
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    std::vector<uint32_t> received;
+    std::array<uint32_t, 16> out;
+    while (received.size() < count)
+    {
+        size_t n = ring.pop(out);
+        if (n == 0)
+        {
+            std::this_thread::yield();
+        }
+        received.insert(received.end(), out.begin(), out.begin() + n);
+    }
+    producer.join();
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        ASSERT_EQ(i, received[i]);
+    }
+}
+
+} // namespace
@@ -0,0 +1,80 @@
+#include "stream_queue.hpp"
+
+#include <cstdint>
+
+#include <gtest/gtest.h>
+
+namespace
+{
+
+lpcsnoop::StreamRecord record(uint64_t sequence)
+{
+    lpcsnoop::StreamRecord r{};
+    r.sequence = sequence;
+    r.timestamp = sequence * 10;
+    r.size = 1;
+    r.code[0] = static_cast<uint8_t>(sequence);
+    return r;
+}
+
+TEST(StreamQueueTest, FrontReturnsOldestRecords)
+{
+    StreamQueue<4> queue;
+    EXPECT_TRUE(queue.empty());
+
+    queue.push(record(0));
+    queue.push(record(1));
+    auto front = queue.front(16);
+    ASSERT_EQ(2u, front.size());
+    EXPECT_EQ(0u, front[0].sequence);
+    EXPECT_EQ(1u, front[1].sequence);
+
+    queue.pop(1);
+    ASSERT_EQ(1u, queue.front(16).size());
+    EXPECT_EQ(1u, queue.front(16)[0].sequence);
+}
+
+TEST(StreamQueueTest, FrontStopsAtWrapAround)
+{
+    StreamQueue<4> queue;
+    for (uint64_t i = 0; i < 4; i++)
+    {
+        queue.push(record(i));
+    }
+    queue.pop(3);
+    queue.push(record(4));
+
+    EXPECT_EQ(1u, queue.front(16).size());
+    queue.pop(1);
+    ASSERT_EQ(1u, queue.front(16).size());
+    EXPECT_EQ(4u, queue.front(16)[0].sequence);
+}
+
+TEST(StreamQueueTest, FullQueueDropsWithGapMarker)
+{
+    StreamQueue<4> queue;
+    for (uint64_t i = 0; i < 7; i++)
+    {
+        queue.push(record(i));
+    }
+
+    // 4, 5 and 6 are lost, 7 fits along with the gap marker.
+    queue.pop(2);
+    queue.push(record(7));
+
+    auto front = queue.front(16);
+    ASSERT_EQ(2u, front.size());
+    EXPECT_EQ(2u, front[0].sequence);
+    EXPECT_EQ(3u, front[1].sequence);
+    queue.pop(2);
+
+    front = queue.front(16);
+    ASSERT_EQ(2u, front.size());
+    EXPECT_EQ(4u, front[0].sequence);
+    EXPECT_EQ(3u, front[0].lost);
+    EXPECT_EQ(7u, front[1].sequence);
+    EXPECT_EQ(0u, front[1].lost);
+    EXPECT_EQ(3u, queue.droppedRecords());
+}
+
+} // namespace
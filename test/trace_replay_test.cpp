@@ -0,0 +1,70 @@
+#include "aspeed_pcc.hpp"
+#include "trace_replay.hpp"
+
+#include <cstdint>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace
+{
+
+std::vector<uint8_t> bytes(const PostCode& code)
+{
+    return {code.bytes().begin(), code.bytes().end()};
+}
+
+TEST(TraceReplayTest, ParsesHexCodes)
+{
+    PostCode code;
+
+    EXPECT_TRUE(parseTraceLine("0x1234", code));
+    EXPECT_EQ((std::vector<uint8_t>{0x12, 0x34}), bytes(code));
+
+    EXPECT_TRUE(parseTraceLine("  abc  # comment", code));
+    EXPECT_EQ((std::vector<uint8_t>{0x0a, 0xbc}), bytes(code));
+
+    EXPECT_TRUE(parseTraceLine("DEADBEEF\r", code));
+    EXPECT_EQ((std::vector<uint8_t>{0xde, 0xad, 0xbe, 0xef}), bytes(code));
+}
+
+TEST(TraceReplayTest, RejectsLinesWithoutCode)
+{
+    PostCode code;
+
+    EXPECT_FALSE(parseTraceLine("", code));
+    EXPECT_FALSE(parseTraceLine("# only a comment", code));
+    EXPECT_FALSE(parseTraceLine("0x", code));
+    EXPECT_FALSE(parseTraceLine("12g4", code));
+    EXPECT_FALSE(parseTraceLine("0x112233445566778899", code));
+}
+
+TEST(TraceReplayTest, EncodesRawCodesAsIs)
+{
+    std::vector<uint8_t> out;
+    encodePostCode(PostCode(std::vector<uint8_t>{0x12, 0x34}), false, out);
+
+    EXPECT_EQ((std::vector<uint8_t>{0x12, 0x34}), out);
+}
+
+TEST(TraceReplayTest, PccEncodingDecodesBack)
+{
+    const PostCode code(std::vector<uint8_t>{0xdd, 0xcc, 0xbb, 0xaa});
+    std::vector<uint8_t> out;
+    encodePostCode(code, true, out);
+
+    EXPECT_EQ((std::vector<uint8_t>{0xaa, 0x40, 0xbb, 0x41, 0xcc, 0x42, 0xdd,
+                                    0x43}),
+              out);
+
+    AspeedPccDecoder<4> decoder;
+    std::vector<PostCode> decoded;
+    decoder.decode(out, [&](std::span<const uint8_t> c) {
+        decoded.emplace_back(c);
+    });
+
+    ASSERT_EQ(1u, decoded.size());
+    EXPECT_EQ(code, decoded[0]);
+}
+
+} // namespace
@@ -0,0 +1,143 @@
+#include "threaded_reader.hpp"
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <system_error>
+#include <vector>
+
+ThreadedReader::ThreadedReader(int postFd) : postFd(postFd)
+{
+    notify = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    stop = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (notify < 0 || stop < 0)
+    {
+        int err = errno;
+        if (notify >= 0)
+        {
+            close(notify);
+        }
+        throw std::system_error(err, std::generic_category(), "eventfd");
+    }
+
+    thread = std::thread(&ThreadedReader::run, this);
+}
+
+ThreadedReader::~ThreadedReader()
+{
+    eventfd_write(stop, 1);
+    thread.join();
+    close(stop);
+    close(notify);
+}
+
+void ThreadedReader::acknowledge()
+{
+    eventfd_t count;
+    eventfd_read(notify, &count);
+}
+
+void ThreadedReader::rearm()
+{
+    eventfd_write(notify, 1);
+}
+
+size_t ThreadedReader::pop(std::span<uint8_t> out, uint64_t& time)
+{
+    const size_t n = ring.pop(out);
+
+    // Skip to the read holding the first byte. A stamp may not be pushed yet
+    // or lost to a full stamp ring, the previous one is the best guess then.
+    while (stamp.end <= poppedBytes && stamps.pop({&stamp, 1}) > 0)
+    {}
+
+    time = stamp.time;
+    poppedBytes += n;
+    return n;
+}
+
+bool ThreadedReader::failed(ssize_t& readb, int& err) const
+{
+    if (!done.load(std::memory_order_acquire))
+    {
+        return false;
+    }
+
+    readb = lastRead;
+    err = lastErrno;
+    return true;
+}
+
+void ThreadedReader::fail(ssize_t readb, int err)
+{
+    lastRead = readb;
+    lastErrno = err;
+    done.store(true, std::memory_order_release);
+    rearm();
+}
+
+void ThreadedReader::run()
+{
+    std::vector<uint8_t> buffer(sysconf(_SC_PAGESIZE));
+    std::array<pollfd, 2> fds = {{{postFd, POLLIN, 0}, {stop, POLLIN, 0}}};
+
+    while (true)
+    {
+        if (poll(fds.data(), fds.size(), -1) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            fail(-1, errno);
+            return;
+        }
+
+        if (fds[1].revents)
+        {
+            return;
+        }
+
+        ssize_t readb;
+        bool pushed = false;
+
+        while ((readb = read(postFd, buffer.data(), buffer.size())) > 0)
+        {
+            const uint64_t time =
+                std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch())
+                    .count();
+
+            // Drop whole reads when full so code boundaries stay aligned.
+            if (ring.push({buffer.data(), static_cast<size_t>(readb)}))
+            {
+                pushedBytes += readb;
+                const ReadStamp readStamp{pushedBytes, time};
+                stamps.push({&readStamp, 1});
+                pushed = true;
+            }
+            else
+            {
+                dropped.fetch_add(readb, std::memory_order_relaxed);
+            }
+        }
+
+        if (pushed)
+        {
+            rearm();
+        }
+
+        if (readb < 0 &&
+            (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+        {
+            continue;
+        }
+
+        fail(readb, errno);
+        return;
+    }
+}
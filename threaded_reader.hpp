@@ -0,0 +1,91 @@
+#pragma once
+
+#include "spsc_ring.hpp"
+
+#include <sys/types.h>
+
+#include <atomic>
+#include <cstdint>
+#include <span>
+#include <thread>
+
+/*
+ * Drains the POST code fd from a dedicated thread into a lock-free ring, so
+ * that a stalled event loop (e.g. flushing to a slow bus) does not leave the
+ * kernel snoop FIFO to overflow. The event loop is woken through an eventfd
+ * and consumes the raw bytes with pop().
+ */
+class ThreadedReader
+{
+  public:
+    static constexpr size_t ringSize = 64 * 1024;
+
+    explicit ThreadedReader(int postFd);
+    ~ThreadedReader();
+    ThreadedReader(const ThreadedReader&) = delete;
+    ThreadedReader& operator=(const ThreadedReader&) = delete;
+
+    /* eventfd that becomes readable when the ring has data or on failure. */
+    int notifyFd() const
+    {
+        return notify;
+    }
+
+    std::thread::native_handle_type nativeHandle()
+    {
+        return thread.native_handle();
+    }
+
+    /* Clear the wakeup, must be done before draining the ring with pop(). */
+    void acknowledge();
+
+    /* Make notifyFd() readable again to resume a partial drain later. */
+    void rearm();
+
+    /*
+     * Move up to out.size() bytes out of the ring. time is set to the
+     * CLOCK_MONOTONIC microseconds the first of them was read at.
+     */
+    size_t pop(std::span<uint8_t> out, uint64_t& time);
+
+    /*
+     * Whether the reader thread stopped on EOF or a read error. If so readb
+     * and err hold the final read() result and errno.
+     */
+    bool failed(ssize_t& readb, int& err) const;
+
+    size_t highWaterMark() const
+    {
+        return ring.highWaterMark();
+    }
+
+    uint64_t droppedBytes() const
+    {
+        return dropped.load(std::memory_order_relaxed);
+    }
+
+  private:
+    /* Byte count pushed up to the end of one read, and its read time. */
+    struct ReadStamp
+    {
+        uint64_t end;
+        uint64_t time;
+    };
+
+    void run();
+    void fail(ssize_t readb, int err);
+
+    int postFd;
+    int notify = -1;
+    int stop = -1;
+    SpscRing<uint8_t, ringSize> ring;
+    SpscRing<ReadStamp, 256> stamps;
+    uint64_t pushedBytes = 0; /* reader thread only */
+    uint64_t poppedBytes = 0; /* consumer only */
+    ReadStamp stamp{0, 0};    /* consumer only */
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<bool> done{false};
+    ssize_t lastRead = 0;
+    int lastErrno = 0;
+    std::thread thread;
+};
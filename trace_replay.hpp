@@ -0,0 +1,84 @@
+#pragma once
+
+#include "post_code.hpp"
+
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+/*
+ * Parse one line of a POST code trace: a code in hex, optionally prefixed
+ * with 0x, whose bytes are listed most significant first, e.g. "0x1234" is
+ * the two byte code {0x12, 0x34}. Blank lines and '#' comments hold no code.
+ *
+ * @return Whether the line held a valid code.
+ */
+inline bool parseTraceLine(std::string_view line, PostCode& code)
+{
+    auto trim = [&line]() {
+        while (!line.empty() && (line.front() == ' ' || line.front() == '\t'))
+        {
+            line.remove_prefix(1);
+        }
+        while (!line.empty() && (line.back() == ' ' || line.back() == '\t' ||
+                                 line.back() == '\r'))
+        {
+            line.remove_suffix(1);
+        }
+    };
+
+    line = line.substr(0, line.find('#'));
+    trim();
+    if (line.starts_with("0x") || line.starts_with("0X"))
+    {
+        line.remove_prefix(2);
+    }
+    if (line.empty() || line.size() > 2 * PostCode::maxSize)
+    {
+        return false;
+    }
+
+    // An odd number of digits has an implicit leading zero.
+    std::array<uint8_t, PostCode::maxSize> bytes;
+    size_t size = (line.size() + 1) / 2;
+    size_t digits = line.size() % 2 ? 1 : 2;
+    for (size_t i = 0; i < size; i++)
+    {
+        auto [end, ec] = std::from_chars(line.data(), line.data() + digits,
+                                         bytes[i], 16);
+        if (ec != std::errc() || end != line.data() + digits)
+        {
+            return false;
+        }
+        line.remove_prefix(digits);
+        digits = 2;
+    }
+
+    code = PostCode({bytes.data(), size});
+    return true;
+}
+
+/*
+ * Append the bytes a snoop device delivers for code to out. Raw devices
+ * deliver the code bytes as they are. The Aspeed PCC delivers one 16-bit
+ * little-endian word per byte, the port 0x40 + n in the upper half, with
+ * the last code byte in word 0, see AspeedPccDecoder.
+ */
+inline void encodePostCode(const PostCode& code, bool pcc,
+                           std::vector<uint8_t>& out)
+{
+    auto bytes = code.bytes();
+    if (!pcc)
+    {
+        out.insert(out.end(), bytes.begin(), bytes.end());
+        return;
+    }
+
+    for (size_t w = 0; w < bytes.size(); w++)
+    {
+        out.push_back(bytes[bytes.size() - 1 - w]);
+        out.push_back(0x40 + w);
+    }
+}